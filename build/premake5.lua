@@ -119,6 +119,13 @@ end
 downloadRaylib = true
 raylib_dir = "external/raylib-master"
 
+-- files of the simulation core. they only use raylib's math types and headers, so the core builds and runs without a window
+ropecore_files = {
+    "../src/RopePhysicsSolver.cpp", "../src/SimdIntegrator.cpp", "../src/ThreadAffinity.cpp", "../src/ColliderWorld.cpp", "../src/RopeShapes.cpp", "../src/MappedFile.cpp", "../src/TrajectoryRecorder.cpp", "../src/InputLog.cpp",
+    "../include/RopePhysicsSolver.h", "../include/SimdIntegrator.h", "../include/RopeNodeStore.h", "../include/ThreadAffinity.h", "../include/SpatialHash.h", "../include/ColliderWorld.h", "../include/RopeShapes.h", "../include/MappedFile.h", "../include/SceneSnapshot.h", "../include/TrajectoryRecorder.h", "../include/InputLog.h",
+    "../include/Rope.h", "../include/RopeNode.h", "../include/PhysicsConfig.h", "../include/Threadpool.h"
+}
+
 workspaceName = 'MyGame'
 baseName = path.getbasename(path.getdirectory(os.getcwd()));
 
@@ -196,6 +203,8 @@ if (downloadRaylib) then
         }
         
         files {"../src/**.c", "../src/**.cpp", "../src/**.h", "../src/**.hpp", "../include/**.h", "../include/**.hpp"}
+        -- the solver comes from ropecore
+        removefiles (ropecore_files)
         
         filter {"system:windows", "action:vs*"}
             files {"../src/*.rc", "../src/*.ico"}
@@ -205,7 +214,7 @@ if (downloadRaylib) then
         includedirs { "../src" }
         includedirs { "../include" }
 
-        links {"raylib"}
+        links {"ropecore", "raylib"}
 
         cdialect "C17"
         cppdialect "C++20"
@@ -217,8 +226,8 @@ if (downloadRaylib) then
 
         filter "action:vs*"
             defines{"_WINSOCK_DEPRECATED_NO_WARNINGS", "_CRT_SECURE_NO_WARNINGS"}
-            dependson {"raylib"}
-            links {"raylib.lib"}
+            dependson {"ropecore", "raylib"}
+            links {"ropecore.lib", "raylib.lib"}
             characterset ("Unicode")
             buildoptions { "/Zc:__cplusplus" }
 
@@ -240,6 +249,74 @@ if (downloadRaylib) then
             links {"OpenGL.framework", "Cocoa.framework", "IOKit.framework", "CoreFoundation.framework", "CoreAudio.framework", "CoreVideo.framework", "AudioToolbox.framework"}
 
         filter{}
+
+
+    -- simulation core: solver, threadpool and config, no window, input or rendering
+    project "ropecore"
+        kind "StaticLib"
+        location "build_files/"
+        targetdir "../bin/%{cfg.buildcfg}"
+
+        language "C++"
+        cppdialect "C++20"
+
+        vpaths
+        {
+            ["Header Files/*"] = { "../include/**.h"},
+            ["Source Files/*"] = { "../src/**.cpp"},
+        }
+        files (ropecore_files)
+
+        includedirs { "../include" }
+        includedirs {raylib_dir .. "/src" }
+
+        flags { "ShadowedVariables"}
+
+        -- gcc and clang would fuse multiplies and adds inside the AVX-512 kernel (its target allows FMA), which rounds differently
+        -- than the scalar, SSE and AVX2 kernels. with contraction off every kernel gives the same bits, so a scene behaves the same on every cpu
+        filter "action:gmake* or xcode*"
+            buildoptions { "-ffp-contract=off" }
+
+        filter "action:vs*"
+            defines{"_CRT_SECURE_NO_WARNINGS"}
+            characterset ("Unicode")
+            buildoptions { "/Zc:__cplusplus" }
+
+        filter{}
+
+
+    -- runs the simulation without a window, for build boxes and batch servers
+    project "RopeSimHeadless"
+        kind "ConsoleApp"
+        location "build_files/"
+        targetdir "../bin/%{cfg.buildcfg}"
+
+        language "C++"
+        cppdialect "C++20"
+
+        files {"../headless/**.cpp", "../headless/**.h"}
+
+        includedirs { "../include" }
+        includedirs {raylib_dir .. "/src" }
+
+        links {"ropecore"}
+
+        flags { "ShadowedVariables"}
+
+        filter "action:vs*"
+            defines{"_CRT_SECURE_NO_WARNINGS"}
+            dependson {"ropecore"}
+            links {"ropecore.lib"}
+            characterset ("Unicode")
+            buildoptions { "/Zc:__cplusplus" }
+
+        filter "system:windows"
+            libdirs {"../bin/%{cfg.buildcfg}"}
+
+        filter "system:linux"
+            links {"pthread"}
+
+        filter{}
         
 
     project "raylib"
@@ -0,0 +1,169 @@
+#include <iostream>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <thread>
+#include "RopePhysicsSolver.h"
+#include "PhysicsConfig.h"
+#include "InputLog.h"
+
+// runs the rope simulation without a window as fast as possible and prints how long it took.
+// usage: RopeSimHeadless [--ropes N] [--nodes N] [--frames N] [--threads N] [--substeps N] [--iterations N] [--pin 0|1] [--soa 0|1]
+//                        [--record file.rtraj] [--replay file.rlog] [--check-simd 0|1]
+// --replay runs a session recorded with InputRecorder (F6 in the app) instead of the generated ropes, and checks that every frame
+// ends exactly where it did while recording. --check-simd 1 then replays it again on every instruction set up to the best one of
+// this cpu, a log recorded on one machine has to replay the same on any other
+
+int main(int argc, char** argv)
+{
+	int ropeCount = 64;
+	int nodesPerRope = 500;
+	int frames = 600;
+	int threadCount = std::thread::hardware_concurrency();
+	int substeps = 6;
+	int iterations = 5;
+	bool pinThreads = false;
+	bool useNodeStore = false;
+	const char* recordPath = nullptr;
+	const char* replayPath = nullptr;
+	bool checkSimd = false;
+
+	for (int i = 1; i + 1 < argc; i += 2) {
+
+		int value = atoi(argv[i + 1]);
+
+		if (strcmp(argv[i], "--ropes") == 0) ropeCount = value;
+		else if (strcmp(argv[i], "--nodes") == 0) nodesPerRope = value;
+		else if (strcmp(argv[i], "--frames") == 0) frames = value;
+		else if (strcmp(argv[i], "--threads") == 0) threadCount = value;
+		else if (strcmp(argv[i], "--substeps") == 0) substeps = value;
+		else if (strcmp(argv[i], "--iterations") == 0) iterations = value;
+		else if (strcmp(argv[i], "--pin") == 0) pinThreads = value != 0;
+		else if (strcmp(argv[i], "--soa") == 0) useNodeStore = value != 0;
+		else if (strcmp(argv[i], "--record") == 0) recordPath = argv[i + 1];
+		else if (strcmp(argv[i], "--replay") == 0) replayPath = argv[i + 1];
+		else if (strcmp(argv[i], "--check-simd") == 0) checkSimd = value != 0;
+		else {
+			std::cerr << "unknown option " << argv[i] << "\n";
+			return 1;
+		}
+	}
+
+	if (threadCount < 1) threadCount = 1;
+
+	Config config;
+	// every frame simulates exactly one frame of time, no real clock involved
+	config.physics.useFixedTimestep = false;
+	if (useNodeStore) config.physics.nodeLayout = NodeLayout::StructOfArrays;
+
+	// the main thread runs ParralelFor too, so it counts as one of the threads
+	ThreadpoolOptions poolOptions;
+	poolOptions.threadCount = threadCount - 1;
+	poolOptions.pinThreads = pinThreads;
+	poolOptions.pinCallingThread = pinThreads;
+
+	Threadpool threadpool(poolOptions);
+	RopePhysicsSolver solver(config, threadpool);
+
+	std::vector<RopeDescriptor> ropes(ropeCount);
+	for (int r = 0; r < ropeCount; r++) {
+		ropes[r].firstNodePos = Vector2{ 100.0f + r * 50.0f, 100 };
+		ropes[r].nodeAmount = nodesPerRope;
+		ropes[r].ropeLengthForEach = 8;
+		ropes[r].nodeRadius = 5;
+	}
+
+	// a replay brings its own scene, settings and input
+	InputReplayer replayer;
+	if (replayPath == nullptr) {
+		solver.SpawnRopes(ropes);
+	}
+	else if (!replayer.Open(replayPath, solver)) {
+		std::cerr << "can't replay " << replayPath << "\n";
+		return 1;
+	}
+
+	// nobody is clicking anything
+	InteractionInput input;
+	double deltaTime = 1.0 / config.TargetFPS;
+
+	// record every frame's node positions, the time it takes counts into the frame time
+	TrajectoryRecorder recorder;
+	if (recordPath != nullptr) {
+
+		if (!recorder.Open(recordPath)) {
+			std::cerr << "can't create " << recordPath << "\n";
+			return 1;
+		}
+		solver.Recorder = &recorder;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+
+	if (replayPath != nullptr) {
+
+		while (replayer.ReplayFrame(solver)) {}
+		frames = replayer.FramesReplayed();
+		ropeCount = solver.AllRopes.size();
+	}
+	else {
+
+		for (int f = 0; f < frames; f++) {
+			solver.HandleRopes(input, substeps, iterations, deltaTime);
+		}
+	}
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	recorder.Close();
+
+	std::cout << ropeCount << " ropes, " << solver.AllNodes.size() << " nodes, " << frames << " frames on " << threadCount << " threads ("
+		<< GetSimdLevelName(solver.simdLevel) << ")\n";
+	std::cout << seconds << " s, " << seconds * 1000 / frames << " ms per frame, "
+		<< frames / seconds << " frames per second\n";
+
+	if (recordPath != nullptr) {
+		std::cout << "recorded " << recorder.FramesRecorded() << " frames into " << recorder.BytesWritten() << " bytes ("
+			<< recorder.QueueStalls() << " waits for the writer)\n";
+	}
+
+	if (replayPath != nullptr) {
+
+		if (replayer.FirstDivergedFrame() == -1) {
+			std::cout << "replay matches the recording\n";
+		}
+		else {
+			std::cout << "replay differs from the recording from frame " << replayer.FirstDivergedFrame() << " on\n";
+			return 2;
+		}
+	}
+
+	if (replayPath != nullptr && checkSimd) {
+
+		uint64_t expectedHash = HashNodeState(solver.AllNodes.data(), solver.AllNodes.size());
+		bool allMatch = true;
+
+		for (int level = 0; level <= (int)DetectSimdLevel(); level++) {
+
+			// a fresh solver and config, the log sets them up the same way as for the first replay
+			Config levelConfig;
+			levelConfig.physics.useFixedTimestep = false;
+			RopePhysicsSolver levelSolver(levelConfig, threadpool);
+			levelSolver.simdLevel = (SimdLevel)level;
+
+			InputReplayer levelReplayer;
+			if (!levelReplayer.Open(replayPath, levelSolver)) return 1;
+			while (levelReplayer.ReplayFrame(levelSolver)) {}
+
+			bool matches = levelReplayer.FirstDivergedFrame() == -1 &&
+				HashNodeState(levelSolver.AllNodes.data(), levelSolver.AllNodes.size()) == expectedHash;
+			allMatch = allMatch && matches;
+
+			std::cout << GetSimdLevelName((SimdLevel)level) << ": " << (matches ? "matches" : "differs") << "\n";
+		}
+
+		if (!allMatch) return 2;
+	}
+
+	return 0;
+}
@@ -2,5 +2,9 @@
 #include<vector>
 #include "raylib.h"
 #include "RopeNode.h"
+#include "PhysicsConfig.h"
 
-void CameraMove(Camera2D& mainCamera);
\ No newline at end of file
+void CameraMove(Camera2D& mainCamera);
+
+// read the mouse and keyboard into the input the solver works with (LMB drags, left CONTROL toggles the anchor)
+InteractionInput ReadInteractionInput(const Camera2D& mainCamera);
\ No newline at end of file
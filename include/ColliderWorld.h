@@ -0,0 +1,105 @@
+#pragma once
+#include <vector>
+#include "raylib.h"
+#include "raymath.h"
+
+// kinds of static shapes nodes can collide with. polylines are stored as their segments
+enum class ColliderShape
+{
+	Segment,
+	Box,		// axis aligned, solid
+	Circle		// solid
+};
+
+struct Collider
+{
+	ColliderShape shape;
+
+	// Segment: a - b, Box: min - max corner, Circle: center in a, radius in radius
+	Vector2 a;
+	Vector2 b;
+	float radius;
+
+	// bounds, for the hierarchy
+	Vector2 boundsMin;
+	Vector2 boundsMax;
+};
+
+// static level geometry, kept in a bounding volume hierarchy so a query only looks at the shapes near it.
+// add shapes at any time, the hierarchy is rebuilt before the next query (by the solver, at the start of a step)
+class ColliderWorld
+{
+public:
+
+	ColliderWorld() = default;
+	~ColliderWorld() = default;
+
+	void AddSegment(Vector2 a, Vector2 b);
+	void AddBox(Vector2 min, Vector2 max);
+	void AddCircle(Vector2 center, float radius);
+	// one segment between every two consecutive points, and from the last back to the first one if closed
+	void AddPolyline(const std::vector<Vector2>& points, bool closed = false);
+	// add a shape as it is, bounds included (snapshots)
+	void Add(const Collider& collider);
+	void Clear();
+
+	bool IsEmpty() const { return colliders.empty(); }
+	const std::vector<Collider>& GetColliders() const { return colliders; }
+
+	// rebuild the hierarchy if shapes were added or removed since the last call. not thread safe, queries are
+	void Update();
+
+	// call func(colliderIndex) for every shape whose bounds overlap [min, max]
+	template<typename Func>
+	void QueryBounds(Vector2 min, Vector2 max, Func&& func) const {
+
+		if (nodes.empty()) return;
+
+		int stack[MaxDepth];
+		int stackSize = 0;
+		stack[stackSize++] = 0;
+
+		while (stackSize > 0) {
+
+			const BvhNode& node = nodes[stack[--stackSize]];
+
+			if (!Overlaps(node.boundsMin, node.boundsMax, min, max)) continue;
+
+			if (node.count > 0) {
+				for (int c = node.first; c < node.first + node.count; c++) {
+					if (Overlaps(colliders[c].boundsMin, colliders[c].boundsMax, min, max)) func(c);
+				}
+			}
+			else {
+				stack[stackSize++] = node.first;
+				stack[stackSize++] = node.first + 1;
+			}
+		}
+	}
+
+	// move a circle out of one shape. returns true and the push if they overlap
+	bool Resolve(int colliderIndex, Vector2 position, float radius, Vector2& push) const;
+
+private:
+
+	struct BvhNode
+	{
+		Vector2 boundsMin;
+		Vector2 boundsMax;
+		int first;	// first collider of a leaf, or the left child (right child = first + 1)
+		int count;	// colliders in a leaf, 0 for inner nodes
+	};
+
+	static bool Overlaps(Vector2 minA, Vector2 maxA, Vector2 minB, Vector2 maxB) {
+		return maxA.x >= minB.x && minA.x <= maxB.x && maxA.y >= minB.y && minA.y <= maxB.y;
+	}
+
+	static constexpr int LeafSize = 4;
+	static constexpr int MaxDepth = 64;
+
+	std::vector<Collider> colliders;
+	std::vector<BvhNode> nodes;
+	bool isDirty = false;
+
+	void BuildNode(int nodeIndex, int first, int count, int depth);
+};
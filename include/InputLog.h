@@ -0,0 +1,148 @@
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include "RopeNode.h"
+#include "PhysicsConfig.h"
+#include "MappedFile.h"
+
+class RopePhysicsSolver;
+
+// file layout: InputLogHeader, the scene snapshot the session started from (at snapshotOffset, snapshotSize bytes),
+// then records, each an InputLogRecord followed by 'size' bytes of payload:
+//  - Physics:		the PhysicsConfig, whenever it changed since the last frame (GUI sliders), and once at the start
+//  - Interaction:	InputLogInteraction, whenever canDrag changed, and once at the start
+//  - SetupRope:	InputLogRope, a rope added between two frames
+//  - RemoveRope:	int32 rope ID, a rope removed between two frames
+//  - Frame:		InputLogFrame, one HandleRopes call with its input and the node state it ended in
+// PhysicsConfig is written as it is in memory, so like snapshots a log only replays on a build with the same struct layouts
+constexpr char InputLogMagic[8] = { 'R', 'O', 'P', 'E', 'I', 'L', 'O', 'G' };
+constexpr uint32_t InputLogVersion = 1;
+
+struct InputLogHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t byteOrderMark;		// SnapshotByteOrderMark
+	uint32_t physicsSize;		// sizeof(PhysicsConfig)
+	uint32_t frameSize;			// sizeof(InputLogFrame)
+	uint64_t snapshotOffset;
+	uint64_t snapshotSize;
+};
+
+enum class InputLogRecordType : uint32_t
+{
+	Physics,
+	Interaction,
+	SetupRope,
+	RemoveRope,
+	Frame
+};
+
+struct InputLogRecord
+{
+	InputLogRecordType type;
+	uint32_t size;
+};
+
+// InputLogFrame::buttons
+constexpr uint32_t InputLogDragHeld = 1;
+constexpr uint32_t InputLogDragReleased = 2;
+constexpr uint32_t InputLogToggleAnchor = 4;
+
+struct InputLogFrame
+{
+	double frameTime;
+	float cursorX;
+	float cursorY;
+	uint32_t buttons;
+	int32_t substeps;
+	int32_t iterations;
+	uint32_t padding;
+	// hash of every node's position and old position after the frame, to find the first frame a replay differs in
+	uint64_t stateHash;
+};
+
+struct InputLogInteraction
+{
+	uint32_t canDrag;
+};
+
+// arguments of RopePhysicsSolver::SetupRope
+struct InputLogRope
+{
+	float firstNodeX;
+	float firstNodeY;
+	uint32_t isFirstNodeAnchored;
+	int32_t nodeAmount;
+	float ropeLengthForEach;
+	float nodeRadius;
+};
+
+// records a session (RopePhysicsSolver::InputLog): every HandleRopes call with its input and frame time, and the settings and
+// ropes that changed in between. together with the scene it started from, that is everything InputReplayer needs to run the
+// session again. turn on config.physics.deterministic while recording, otherwise collisions won't replay bit for bit
+class InputRecorder
+{
+public:
+
+	InputRecorder() = default;
+	~InputRecorder() { Close(); }
+
+	InputRecorder(const InputRecorder&) = delete;
+	InputRecorder& operator=(const InputRecorder&) = delete;
+
+	// create the log and write the solver's scene into it. the solver then reloads that scene, so the session goes on from
+	// exactly the state a replay starts from (a dragged node is let go, back in the anchor state it had before the drag, and old rope
+	// handles go stale). false if the file can't be written
+	bool Open(const char* path, RopePhysicsSolver& solver);
+	void Close();
+	bool IsOpen() const { return file.is_open(); }
+
+	// called by HandleRopes at the end of every call
+	void RecordFrame(const RopePhysicsSolver& solver, const InteractionInput& input, int substeps, int iterations, double frameTime);
+	// ropes added or removed outside of HandleRopes (the GUI buttons) have to be recorded by whoever changes them
+	void RecordSetupRope(Vector2 firstNodePos, bool isFirstNodeAnchored, int nodeAmount, float ropeLengthForEach, float nodeRadius);
+	void RecordRemoveRope(int ropeID);
+
+	uint32_t FramesRecorded() const { return framesRecorded; }
+
+private:
+
+	std::ofstream file;
+	uint32_t framesRecorded = 0;
+
+	// what the log holds so far, to only write changes
+	PhysicsConfig lastPhysics;
+	bool lastCanDrag = true;
+
+	void WriteRecord(InputLogRecordType type, const void* payload, uint32_t size);
+	void WriteSettings(const Config& config, bool force);
+};
+
+// replays an input log: loads the scene it starts with and runs every recorded frame through HandleRopes again, with the same
+// settings, ropes and input. with the same build and a deterministic recording the nodes end up exactly where they did while recording,
+// no matter the thread count, so a session can be debugged or benchmarked as often as needed
+class InputReplayer
+{
+public:
+
+	// map the log and load its scene into the solver. false if the file isn't an input log of this build
+	bool Open(const char* path, RopePhysicsSolver& solver);
+
+	// apply the changes recorded before the next frame and simulate it. false at the end of the log (or at a damaged record)
+	bool ReplayFrame(RopePhysicsSolver& solver);
+
+	uint32_t FramesReplayed() const { return framesReplayed; }
+	// first frame that ended in a different state than it did while recording, -1 as long as all of them matched
+	int64_t FirstDivergedFrame() const { return firstDivergedFrame; }
+
+private:
+
+	MappedFile file;
+	uint64_t readOffset = 0;
+	uint32_t framesReplayed = 0;
+	int64_t firstDivergedFrame = -1;
+};
+
+// hash of the nodes' positions and old positions, bit for bit
+uint64_t HashNodeState(const RopeNode* nodes, int nodeCount);
@@ -0,0 +1,32 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// read only view of a whole file, mapped into memory. pages are only read from disk when they are touched
+class MappedFile
+{
+public:
+
+	MappedFile() = default;
+	~MappedFile() { Close(); }
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// returns false if the file can't be opened or is empty
+	bool Open(const char* path);
+	void Close();
+
+	const uint8_t* Data() const { return data; }
+	size_t Size() const { return size; }
+
+private:
+
+	const uint8_t* data = nullptr;
+	size_t size = 0;
+
+	// file and mapping handles on windows, the file descriptor elsewhere
+	void* fileHandle = nullptr;
+	void* mappingHandle = nullptr;
+	int fileDescriptor = -1;
+};
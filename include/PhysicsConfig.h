@@ -4,6 +4,13 @@
 #include <vector>
 #include "Rope.h"
 
+// how the solver keeps node data in memory while simulating
+enum class NodeLayout
+{
+    ArrayOfStructs,     // work directly on AllNodes
+    StructOfArrays      // copy AllNodes into a RopeNodeStore once per frame and simulate on separate x/y/oldX/oldY/acceleration arrays
+};
+
 struct PhysicsConfig
 {
     // physics variables
@@ -12,6 +19,54 @@ struct PhysicsConfig
     float dragCoef;
     bool areRopesRigid; //control if ropes can fold onto themselves
 
+    // memory layout used by the integration and constraint passes
+    NodeLayout nodeLayout = NodeLayout::ArrayOfStructs;
+    // use the SSE/AVX2/AVX-512 integration kernel (StructOfArrays layout only)
+    bool useSimdIntegration = true;
+    // ropes with at least this many nodes are solved with the parallel red/black solver instead of on a single thread. 0 turns it off
+    int coloredSolveMinNodes = 10000;
+    // max tridiagonal solves per sub-step for ropes using ConstraintSolver::Direct. one is exact for the linearized chain,
+    // another one only runs if the chain is still off (fast motion, slack links that got pulled tight)
+    int directSolveSweeps = 4;
+    // step every rope through all sub-steps (integration, dragging and constraints) inside one task instead of
+    // syncing all threads twice per sub-step. ropes handled by the colored solver still run sub-step by sub-step, after the others
+    bool fusedRopePipeline = false;
+    // keep nodes of different ropes (and, with ropeSelfCollisions, of the same rope) at least their radii apart.
+    // runs once per sub-step after the constraints. turns fusedRopePipeline off, because ropes can't be stepped on their own anymore
+    bool nodeCollisions = false;
+    bool ropeSelfCollisions = true;
+    // push nodes out of the solver's static colliders once per sub-step, after the constraints. friction (0 - 1) is the part
+    // of a touching node's sliding velocity it loses per contact
+    bool staticCollisions = true;
+    float colliderFriction = 0.1f;
+    // give the same results, bit for bit, on every run with the same input: the collision broadphase keeps the nodes of a cell in
+    // index order instead of the order the threads got to them. everything else already works in fixed chunks with fixed
+    // reduction order, and the integration kernels round the same on every instruction set (RopeSimHeadless --replay with
+    // --check-simd 1 checks that). needed to replay an input log exactly
+    bool deterministic = false;
+    // stop the constraint iterations of a rope once no link is off by more than this fraction of its length. 0 always runs every iteration
+    float constraintTolerance = 0.001f;
+
+    // ropes whose average kinetic energy per node stays below the threshold for sleepFrames frames stop being simulated until woken up
+    bool allowSleeping = true;
+    float sleepEnergyThreshold = 2.0f;
+    int sleepFrames = 60;
+
+    // simulate in fixed steps that don't depend on the frame time. the renderer interpolates between the last two steps.
+    // if a frame needs more than maxStepsPerFrame steps, the rest of the time is dropped
+    bool useFixedTimestep = true;
+    float fixedTimeStep = 1.0f / 60.0f;
+    int maxStepsPerFrame = 4;
+
+    // let the solver pick the sub-step count of every step (within minSubsteps and maxSubsteps) instead of using the one passed to HandleRopes.
+    // it uses enough sub-steps that no node moves more than maxSubstepTravel link lengths per sub-step,
+    // and more if the constraint error left after the last step was above targetResidualError (fraction of the link length)
+    bool adaptiveSubsteps = false;
+    int minSubsteps = 2;
+    int maxSubsteps = 16;
+    float maxSubstepTravel = 0.5f;
+    float targetResidualError = 0.01f;
+
 
     // Default Constructor
     // It calls the other constructor below, passing in the default values you want.
@@ -33,7 +88,7 @@ struct InteractionConfig
 {
     // Variables to keep state between frames for rope interaction
     int draggedNodeID = -1;
-    Rope* draggedRope = nullptr;
+    RopeHandle draggedRope;
     bool wasAnchored = false;
     bool canDrag = true;
 
@@ -51,6 +106,16 @@ struct InteractionConfig
     {}
 };
 
+// input the solver reacts to during one frame. the app fills it from the mouse and keyboard,
+// a headless run leaves it empty (or replays recorded input), so the solver never polls a window itself
+struct InteractionInput
+{
+    Vector2 cursorWorldPos = { 0,0 };
+    bool dragHeld = false;              // drag button is down
+    bool dragReleased = false;          // drag button went up this frame
+    bool toggleAnchorPressed = false;   // toggle the anchor of the dragged node this frame
+};
+
 struct Config
 {
     //other
@@ -1,7 +1,27 @@
 #pragma once
 #include <vector>
+#include <cstdint>
 #include "RopeNode.h"
 
+// how the distance constraints of a rope are solved
+enum class ConstraintSolver
+{
+	Relaxation,		// relax every link 'iterations' times
+	Direct,			// linearize the whole chain and solve it exactly with one tridiagonal (Thomas algorithm) pass
+	XPBD			// compliant constraints with Lagrange multipliers, stiffness set by 'compliance' and independent of sub-steps and iterations
+};
+
+// refers to one rope for as long as it exists. a rope's ID (its index in AllRopes) changes when ropes before it are removed,
+// its handle doesn't. once the rope is removed the handle is stale and never refers to another rope (the generation differs)
+struct RopeHandle
+{
+	int slot = -1;
+	uint32_t generation = 0;
+
+	bool IsNull() const { return slot == -1; }
+	bool operator==(const RopeHandle& other) const = default;
+};
+
 // simply stores all nodes and other data of a rope
 struct Rope
 {
@@ -9,9 +29,29 @@ struct Rope
 		int startNodeIndex;
 		int nodeAmount;
 
+		// set by the solver when the rope is created
+		RopeHandle handle;
+
 		float Radius;
 		float RopeLengthForEach;
 
+		ConstraintSolver solver = ConstraintSolver::Relaxation;
+		// inverse stiffness of the links for ConstraintSolver::XPBD. 0 is an inextensible rope
+		float compliance = 0.0f;
+
+		// constraint iterations (or direct solve sweeps) this rope ran during the last frame, over all sub-steps
+		int iterationsUsed = 0;
+
+		// a sleeping rope is skipped by the solver. calmFrames counts the frames its kinetic energy stayed below the sleep threshold
+		bool isSleeping = false;
+		int calmFrames = 0;
+
+		// measured after every step: average kinetic energy per node, speed of the fastest node,
+		// and the largest link error (relative to RopeLengthForEach) seen in the last constraint iteration
+		float kineticEnergy = 0;
+		float maxNodeSpeed = 0;
+		float residualError = 0;
+
 		Rope(int _nodeAmount, float _radius, float _ropeLength) :
 
 			nodeAmount(_nodeAmount),
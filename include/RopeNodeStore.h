@@ -0,0 +1,161 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include "raylib.h"
+#include "RopeNode.h"
+
+// allocator that leaves new elements uninitialized instead of zeroing them. the memory of a new buffer then stays untouched
+// until the gather writes it from the threads that later simulate those nodes, so the os places every page on their NUMA node (first touch)
+template<typename T>
+struct DefaultInitAllocator : std::allocator<T>
+{
+	template<typename U>
+	struct rebind { using other = DefaultInitAllocator<U>; };
+
+	DefaultInitAllocator() = default;
+	template<typename U>
+	DefaultInitAllocator(const DefaultInitAllocator<U>&) noexcept {}
+
+	template<typename U>
+	void construct(U* pointer) noexcept(std::is_nothrow_default_constructible_v<U>) { ::new((void*)pointer) U; }
+
+	template<typename U, typename... Args>
+	void construct(U* pointer, Args&&... args) { ::new((void*)pointer) U(std::forward<Args>(args)...); }
+};
+
+template<typename T>
+using NodeArray = std::vector<T, DefaultInitAllocator<T>>;
+
+// structure-of-arrays copy of all rope nodes
+// every field lives in its own contiguous array, so the integration and constraint loops
+// only pull the data they actually use into cache (no padding, no cold fields)
+struct RopeNodeStore
+{
+	public:
+
+		NodeArray<float> x;
+		NodeArray<float> y;
+		NodeArray<float> oldX;
+		NodeArray<float> oldY;
+		NodeArray<float> accX;
+		NodeArray<float> accY;
+		NodeArray<int> ropeID;
+
+		// one bit per node, set if the node is anchored. 64 nodes share one word
+		NodeArray<uint64_t> anchorBits;
+
+		RopeNodeStore() = default;
+		~RopeNodeStore() = default;
+
+		int Size() const { return (int)x.size(); }
+
+		// amount of 64-node words in the anchor bitset
+		int WordCount() const { return (int)anchorBits.size(); }
+
+		// the contents are undefined afterwards, fill the store with GatherWord
+		void Resize(int nodeCount) {
+
+			// growing would copy the old nodes on this thread, touching the new pages from here. start from fresh buffers instead
+			if (nodeCount > (int)x.capacity()) {
+				*this = RopeNodeStore();
+			}
+
+			x.resize(nodeCount);
+			y.resize(nodeCount);
+			oldX.resize(nodeCount);
+			oldY.resize(nodeCount);
+			accX.resize(nodeCount);
+			accY.resize(nodeCount);
+			ropeID.resize(nodeCount);
+			anchorBits.resize((nodeCount + 63) / 64);
+		}
+
+		bool IsAnchored(int i) const {
+
+			return (anchorBits[i >> 6] >> (i & 63)) & 1;
+		}
+
+		// not thread safe: neighbouring nodes share a word
+		void SetAnchored(int i, bool isAnchored) {
+
+			uint64_t bit = uint64_t(1) << (i & 63);
+
+			if (isAnchored) {
+				anchorBits[i >> 6] |= bit;
+			}
+			else {
+				anchorBits[i >> 6] &= ~bit;
+			}
+		}
+
+		// copy a single node into the store
+		void LoadNode(int i, const RopeNode& node) {
+
+			x[i] = node.Position.x;
+			y[i] = node.Position.y;
+			oldX[i] = node.OldPosition.x;
+			oldY[i] = node.OldPosition.y;
+			accX[i] = node.Acceleration.x;
+			accY[i] = node.Acceleration.y;
+			ropeID[i] = node.RopeID;
+			SetAnchored(i, node.IsAnchored);
+		}
+
+		// copy only the position of a node into the store. leaves the anchor word alone, so other threads may read it meanwhile
+		void LoadNodePosition(int i, const RopeNode& node) {
+
+			x[i] = node.Position.x;
+			y[i] = node.Position.y;
+			oldX[i] = node.OldPosition.x;
+			oldY[i] = node.OldPosition.y;
+		}
+
+		// copy a single node back out of the store
+		void StoreNode(int i, RopeNode& node) const {
+
+			node.Position = { x[i], y[i] };
+			node.OldPosition = { oldX[i], oldY[i] };
+			node.Acceleration = { accX[i], accY[i] };
+			node.RopeID = ropeID[i];
+			node.IsAnchored = IsAnchored(i);
+		}
+
+		// copy the 64 nodes that share anchor word 'word'. different words can be gathered from different threads
+		void GatherWord(const NodeArray<RopeNode>& nodes, int word) {
+
+			int begin = word * 64;
+			int end = begin + 64 < (int)nodes.size() ? begin + 64 : (int)nodes.size();
+
+			uint64_t bits = 0;
+
+			for (int i = begin; i < end; i++) {
+
+				const RopeNode& node = nodes[i];
+
+				x[i] = node.Position.x;
+				y[i] = node.Position.y;
+				oldX[i] = node.OldPosition.x;
+				oldY[i] = node.OldPosition.y;
+				accX[i] = node.Acceleration.x;
+				accY[i] = node.Acceleration.y;
+				ropeID[i] = node.RopeID;
+
+				if (node.IsAnchored) bits |= uint64_t(1) << (i - begin);
+			}
+
+			anchorBits[word] = bits;
+		}
+
+		// write the 64 nodes that share anchor word 'word' back into the node buffer
+		void ScatterWord(NodeArray<RopeNode>& nodes, int word) const {
+
+			int begin = word * 64;
+			int end = begin + 64 < (int)nodes.size() ? begin + 64 : (int)nodes.size();
+
+			for (int i = begin; i < end; i++) {
+				StoreNode(i, nodes[i]);
+			}
+		}
+};
@@ -1,12 +1,21 @@
 #pragma once
 #include <vector>
+#include <iosfwd>
 #include "raylib.h"
 #include "raymath.h"
 #include "RopeNode.h"
+#include "RopeNodeStore.h"
+#include "SimdIntegrator.h"
 #include "Rope.h"
-#include "RopeRenderer.h"
 #include "PhysicsConfig.h"
 #include "Threadpool.h"
+#include "SpatialHash.h"
+#include "ColliderWorld.h"
+#include "RopeShapes.h"
+#include "SceneSnapshot.h"
+#include "TrajectoryRecorder.h"
+
+class InputRecorder;
 
 class RopePhysicsSolver
 {
@@ -14,37 +23,203 @@ public:
 
 	// vector to store all nodes of all ropes in one buffer
 	// and a vector that stores an index where a specific ropes starts at AllNodes and other thats needed on a per-rope basis
+	// (growing AllNodes leaves the new nodes uninitialized, so the threads that fill them in are the first to touch the memory)
 	std::vector<Rope> AllRopes;
-	std::vector<RopeNode> AllNodes;
+	NodeArray<RopeNode> AllNodes;
+
+	// structure-of-arrays copy of AllNodes, only used when config.physics.nodeLayout is StructOfArrays.
+	// it is filled at the start of UpdateRopes and written back to AllNodes at the end, so AllNodes is always valid between frames
+	RopeNodeStore NodeStore;
+
+	// accumulated Lagrange multipliers of XPBD ropes. one per link, at the index of the link's first node
+	std::vector<float> LinkLambdas;
+
+	// constraint iterations all ropes actually ran during the last UpdateRopes (sub-steps included)
+	int LastFrameIterations = 0;
+	// sub-steps used by the last step (only differs from the requested count with config.physics.adaptiveSubsteps)
+	int LastSubsteps = 1;
+
+	// fixed time step state: simulated time we still owe, node positions before the last step and how far
+	// the current frame is between them (0 = PreviousPositions, 1 = AllNodes)
+	double TimeAccumulator = 0;
+	std::vector<Vector2> PreviousPositions;
+	float InterpolationAlpha = 1;
+
+	// static level geometry the nodes collide with (config.physics.staticCollisions). add shapes at any time
+	ColliderWorld Colliders;
+
+	// if set (and open), every step's node positions are recorded, after each fixed step or at the end of UpdateRopes
+	TrajectoryRecorder* Recorder = nullptr;
+	// if set (and open), every HandleRopes call is written to an input log that InputReplayer can replay
+	InputRecorder* InputLog = nullptr;
+
+	// widest instruction set the integration kernel can use on this machine
+	SimdLevel simdLevel;
 
 	// config to get the physics and interaction data from
 	Config& config;
 	// a threadpool used for multithreading
 	Threadpool& threadpool;
 
-	RopePhysicsSolver(Config& CFG, Threadpool& tp) : config(CFG), threadpool(tp) {}
+	RopePhysicsSolver(Config& CFG, Threadpool& tp) : simdLevel(DetectSimdLevel()), config(CFG), threadpool(tp), lastPhysics(CFG.physics) {}
 	~RopePhysicsSolver() = default;
 
 	// add acceleration to nodes as a force
 	void Accelerate(RopeNode& ropenode, const Vector2 acceleration);
 
-	// set up the rope
+	// set up the rope. the reference is only valid until the next rope is added or removed, keep rope.handle instead
 	Rope& SetupRope(const Vector2 firstNodePos, bool isFirstNodeStatic, int nodeAmount, float RopeLengthForEachNode, float nodeRadius);
+	// create many ropes at once, in any RopeShape. the buffers grow once and the nodes are placed in parallel, so this is
+	// much faster than calling SetupRope in a loop. returns the handles of the new ropes, in order
+	std::vector<RopeHandle> SpawnRopes(const std::vector<RopeDescriptor>& descriptors);
+	// delete ropes and close the gaps they leave in AllNodes. ropes after a removed one move down (their IDs and startNodeIndex change,
+	// their handles stay valid). removing many ropes at once only moves every node once
+	void RemoveRope(int ropeID);
+	void RemoveRope(const RopeHandle handle);
+	void RemoveRopes(const std::vector<int>& ropeIDs);
+	// rope (or its index in AllRopes) of a handle, nullptr (-1) once the rope was removed
+	Rope* GetRope(const RopeHandle handle);
+	int GetRopeID(const RopeHandle handle) const;
+	// write all ropes, nodes and static colliders to a binary snapshot, or replace them with the ones of a snapshot. loading maps the
+	// file and copies the node arrays as they are, so it takes about as long as reading the file. both return false on failure,
+	// a failed load leaves the solver untouched
+	bool SaveSnapshot(const char* path) const;
+	bool LoadSnapshot(const char* path);
+	// the same for a snapshot inside another stream or file (an input log starts with one)
+	bool SaveSnapshot(std::ostream& file) const;
+	bool LoadSnapshot(const uint8_t* data, size_t size);
+	// make room for this many nodes in total. ropes created within that never move the existing nodes in memory, and removing
+	// or loading ropes keeps the room. reserving only takes address space, the memory is first touched when nodes are created
+	void ReserveNodes(int nodeCount);
 	//update a specific rope
-	void UpdateRopes(Camera2D& camera, const int substeps, const int iterations, const double deltaTime);
-	//update all ropes
-	void HandleRopes(Camera2D& camera, const int substeps, const int iterations, const double deltaTime);
+	void UpdateRopes(const InteractionInput& input, const int substeps, const int iterations, const double deltaTime);
+	//update all ropes with fixed steps of config.physics.fixedTimeStep, frameTime is the real time the last frame took
+	void UpdateRopesFixed(const InteractionInput& input, const int substeps, const int iterations, const double frameTime);
+	//update all ropes. rendering is up to the caller (RopeRenderer::RenderAllRopes), so this runs without a window
+	void HandleRopes(const InteractionInput& input, const int substeps, const int iterations, const double deltaTime);
 
 	//handle mouse interactions
-	Vector2 FindNodeToMove(Rope& rope, Camera2D& mainCamera);
-	void ToggleAnchor(Rope& rope);
-	void MoveRopeNode(Rope& rope, const Camera2D& mainCamera, const int substeps, const int i, const Vector2 dragStartFramePos);
+	Vector2 FindNodeToMove(const InteractionInput& input, const bool dragPressed);
+	void ToggleAnchor(Rope& rope, const InteractionInput& input);
+	void MoveRopeNode(Rope& rope, const InteractionInput& input, const int substeps, const int i, const Vector2 dragStartFramePos);
+	void ReleaseRopeNode(Rope& rope, const InteractionInput& input);
+
+	// sleeping ropes cost nothing until something wakes them (dragging, anchor toggles, physics changes, contacts)
+	void WakeRope(Rope& rope);
+	void WakeAllRopes();
 
 
 private:
 
+	// nodes per integration task. a multiple of 64, so tasks never share an anchor word
+	static constexpr int IntegrationBlockSize = 1024;
+	// links of one color per task in the colored constraint solver
+	static constexpr int ColoredLinkBlockSize = 2048;
+	// largest link error of every block of the current color
+	std::vector<float> ColoredBlockErrors;
+	// groups of ropes per thread in the per-rope constraint pass
+	static constexpr int RopeGroupsPerThread = 4;
+	// group g holds the ropes [RopeGroupStarts[g], RopeGroupStarts[g + 1]). rebuilt when ropes are added or removed, or when
+	// a rope moves between the colored and the per-rope solve (its solver or coloredSolveMinNodes changed)
+	std::vector<int> RopeGroupStarts;
+	bool ropeGroupsDirty = true;
+	// UsesColoredSolve of every rope when the groups were built
+	std::vector<uint8_t> RopeGroupsColored;
+	// links shorter than their length by less than this fraction still take part in the direct solve
+	static constexpr float DirectSolveSlack = 0.01f;
+	// the direct solve stops sweeping once no link is off by more than this fraction of its length
+	static constexpr float DirectSolveTolerance = 0.0005f;
+
 	void UpdateRopeNodePosition(RopeNode& node, Rope& rope, const double deltaTime);
+	void IntegrateNodeStoreRange(int begin, int end, const double deltaTime);
 	void ApplyForces(RopeNode& node);
-	void ApplyConstraints(std::vector<RopeNode>& nodes, Rope& rope, const int iterations);
+	float SolveLink(const int i, const Rope& rope);
+	float SolveLinkXPBD(const int i, const Rope& rope, const float alphaTilde);
+	float SolveRopeLink(const int i, const Rope& rope, const float alphaTilde);
+	bool HasConverged(const Rope& rope, const float maxError) const;
+	float BeginRopeSubstep(const Rope& rope, const double deltaTime);
+	void ApplyConstraints(Rope& rope, const int iterations, const double deltaTime);
+	void ApplyConstraintsColored(Rope& rope, const int iterations, const double deltaTime);
+	int ApplyConstraintsDirect(Rope& rope);
+	bool UsesColoredSolve(const Rope& rope) const;
+	void BuildRopeGroups();
+	bool RopeGroupsOutdated() const;
+
+	// layout independent node access used by the constraint solver
+	bool UsesNodeStore() const { return config.physics.nodeLayout == NodeLayout::StructOfArrays; }
+	Vector2 GetNodePosition(int i) const;
+	Vector2 GetNodeOldPosition(int i) const;
+	bool IsNodeAnchored(int i) const;
+	void OffsetNode(int i, const Vector2 positionOffset, const Vector2 oldPositionOffset);
+
+	void StepSimulation(const InteractionInput& input, const int requestedSubsteps, const int iterations, const double deltaTime);
+	void StepRopesFused(const InteractionInput& input, const int substeps, const int iterations, const float subDT, const Vector2 dragStartFramePos);
+	void IntegrateRope(Rope& rope, const int begin, const int end, const float subDT);
+	void MoveDraggedNode(Rope& rope, const InteractionInput& input, const int substeps, const int i, const Vector2 dragStartFramePos);
+	void FinishFrameInteraction(const InteractionInput& input);
+
+	void SolveNodeCollisions();
+	void CollideNodeStoreRange(int begin, int end);
+	void CollideRopeNodes(const Rope& rope, int begin, int end);
+
+	void WakeOnPhysicsChange();
+	void MeasureRopeMotion(const float subDT);
+	void UpdateSleepState();
+	int ChooseSubsteps(const double deltaTime);
+
+	// node positions, indexed when the mouse tries to grab a node
+	SpatialHash PickingHash;
+	// drag button state of the last step, a node is only picked in the step the button goes down
+	bool dragHeldLastStep = false;
+
+	// broadphase of the node collisions, rebuilt every sub-step
+	SpatialHash CollisionHash;
+	// nodes per narrowphase task
+	static constexpr int CollisionBlockSize = 2048;
+	// per node data of the narrowphase, in the order of CollisionHash.SortedPoints()
+	struct CollisionNode
+	{
+		int ropeID;
+		float radius;
+		float weight;	// 0 for anchored nodes
+		bool isSleeping;
+	};
+	std::vector<CollisionNode> CollisionNodes;
+	// summed push and amount of contacts of every node in the current collision pass
+	std::vector<Vector2> CollisionDeltas;
+	std::vector<int> CollisionCounts;
+	// set for every rope that had a node pushed, to wake it up
+	std::vector<uint8_t> RopeContacts;
+
+	// nodes that share one collider query: the shapes near their bounds are gathered once and then tested against each node
+	static constexpr int ColliderBatchSize = 64;
+	// a batch with more shapes than this near it queries the hierarchy per node instead
+	static constexpr int MaxBatchedColliders = 16;
+
+	// AllNodes grows by at least this factor when a new rope doesn't fit into what was reserved, so spawning many ropes
+	// past it only copies the nodes a few times
+	static constexpr float NodeGrowthFactor = 1.5f;
+	// nodes ReserveNodes made room for, the node buffers don't shrink below it
+	int reservedNodes = 0;
+	void GrowNodeBuffers(int nodeCount);
+	// where every handle's rope is. a slot's generation goes up when its rope is removed, which makes old handles to it stale
+	struct RopeSlot
+	{
+		int ropeID;
+		uint32_t generation;
+	};
+	std::vector<RopeSlot> RopeSlots;
+	std::vector<int> FreeRopeSlots;
+	RopeHandle AllocateRopeHandle(int ropeID);
+
+	// nodes per copy task when loading a snapshot
+	static constexpr int SnapshotBlockSize = 1 << 16;
+
+	// physics settings of the last frame, to notice changes from the GUI
+	PhysicsConfig lastPhysics;
+
+	// copy AllNodes into NodeStore and back
+	void GatherNodeStore();
+	void ScatterNodeStore();
 };
 
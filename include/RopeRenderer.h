@@ -1,7 +1,9 @@
 #pragma once
 #include "raylib.h"
 #include "rlgl.h"
+#include "raymath.h"
 #include "Rope.h"
+#include "RopePhysicsSolver.h"
 
 class RopeRenderer
 {
@@ -10,6 +12,11 @@ public:
 	~RopeRenderer() = default;
 
 	static void DrawSquaresBatched(const std::vector<Vector2>& positions, float size, Color color);
-	static void RenderRopes(Camera2D& camera, Rope& ropes, std::vector<RopeNode>& nodes);
+	// previousPositions and alpha blend every node between its position before the last physics step and now (alpha = 1 is the current position)
+	static void RenderRopes(Camera2D& camera, Rope& ropes, NodeArray<RopeNode>& nodes, const std::vector<Vector2>& previousPositions, float alpha);
+	// render every rope of the solver, interpolated by the solver's InterpolationAlpha
+	static void RenderAllRopes(Camera2D& camera, RopePhysicsSolver& solver);
+	// outlines of the static colliders
+	static void RenderColliders(const ColliderWorld& colliders, Color color);
 
 };
\ No newline at end of file
@@ -0,0 +1,63 @@
+#pragma once
+#include <vector>
+#include "raylib.h"
+#include "raymath.h"
+
+// initial layout of a rope's nodes
+enum class RopeShape
+{
+	Line,		// straight from the first node along 'direction' (SetupRope uses this to the right)
+	Catenary,	// hanging between the first node and 'endPos' like a rope at rest. pulled straight if it is too short to sag
+	Polyline,	// from the first node through 'points', continuing in the direction of the last segment if the rope is longer
+	Spiral		// Archimedean spiral around the first node, 'spiralSpacing' apart between turns
+};
+
+// everything needed to create one rope, for RopePhysicsSolver::SpawnRopes
+struct RopeDescriptor
+{
+	Vector2 firstNodePos = { 0,0 };
+	bool isFirstNodeAnchored = true;
+	bool isLastNodeAnchored = false;
+	int nodeAmount = 2;
+	float ropeLengthForEach = 10;
+	float nodeRadius = 5;
+
+	RopeShape shape = RopeShape::Line;
+	Vector2 direction = { 1,0 };
+	Vector2 endPos = { 0,0 };
+	std::vector<Vector2> points;
+	float spiralSpacing = 20;
+};
+
+// places the nodes of one rope along its shape. set up once per rope (fits the catenary, measures the polyline),
+// after that NodePosition can be called for any node from any thread
+class RopeShapeSampler
+{
+public:
+
+	explicit RopeShapeSampler(const RopeDescriptor& ropeDescriptor);
+
+	// position of node i, ropeLengthForEach * i along the shape from the first node
+	Vector2 NodePosition(int i) const;
+
+private:
+
+	const RopeDescriptor* descriptor;
+	RopeShape shape;
+	Vector2 direction;
+
+	// catenary y = a * cosh(u) + c with u = (x - x0) / a, in math coordinates (y up, x mirrored if the end is left of the start).
+	// the rope starts at u1, at height y1
+	double catenaryA = 1;
+	double catenaryX0 = 0;
+	double catenaryU1 = 0;
+	double catenaryY1 = 0;
+	float catenaryMirror = 1;
+
+	// distance along the polyline at every point
+	std::vector<float> polylineDistances;
+
+	Vector2 CatenaryPosition(float distance) const;
+	Vector2 PolylinePosition(float distance) const;
+	Vector2 SpiralPosition(float distance) const;
+};
@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+
+// binary snapshot of a solver's ropes, nodes and static colliders (RopePhysicsSolver::SaveSnapshot / LoadSnapshot).
+//
+// layout: SnapshotHeader, then the sections at the offsets it lists, every one aligned to SnapshotAlignment:
+//  - ropeCount SnapshotRopes
+//  - nodeCount RopeNodes, exactly as they are in memory
+//  - nodeCount floats, the XPBD multipliers (LinkLambdas)
+//  - colliderCount Colliders, exactly as they are in memory
+// the node and collider arrays are copied straight out of the mapped file, so a snapshot only loads on a build with the same
+// struct layouts and byte order. the header records both and LoadSnapshot refuses anything else
+
+constexpr char SnapshotMagic[8] = { 'R', 'O', 'P', 'E', 'S', 'N', 'A', 'P' };
+// bump whenever the layout of the file or of a struct in it changes
+constexpr uint32_t SnapshotVersion = 1;
+constexpr uint32_t SnapshotByteOrderMark = 0x01020304;
+constexpr uint64_t SnapshotAlignment = 64;
+
+struct SnapshotHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t byteOrderMark;
+
+	uint32_t ropeSize;		// sizeof of every record type, to catch struct layout changes
+	uint32_t nodeSize;
+	uint32_t colliderSize;
+	uint32_t ropeCount;
+
+	uint64_t nodeCount;
+	uint64_t colliderCount;
+
+	uint64_t ropeOffset;
+	uint64_t nodeOffset;
+	uint64_t lambdaOffset;
+	uint64_t colliderOffset;
+	uint64_t fileSize;
+};
+
+// per rope state. sizes of the rope, solver settings and sleep state, the per frame measurements are not kept
+struct SnapshotRope
+{
+	int32_t startNodeIndex;
+	int32_t nodeAmount;
+	float radius;
+	float ropeLengthForEach;
+	uint32_t solver;
+	float compliance;
+	uint32_t isSleeping;
+	int32_t calmFrames;
+};
@@ -0,0 +1,29 @@
+#pragma once
+#include "RopeNodeStore.h"
+
+// instruction sets the batched integration kernel can use, picked at runtime
+enum class SimdLevel
+{
+	Scalar,
+	SSE,		// 4 nodes per instruction
+	AVX2,		// 8 nodes per instruction
+	AVX512		// 16 nodes per instruction
+};
+
+// values shared by every node of one rope for one sub-step
+struct IntegrationParams
+{
+	float deltaTime;
+	Vector2 g;
+
+	// 0.5 * airDensity * dragCoef * crossSection. quadratic drag then scales the velocity by (1 - dragConstant * |velocity|)
+	float dragConstant;
+};
+
+// best instruction set supported by this cpu (and os)
+SimdLevel DetectSimdLevel();
+const char* GetSimdLevelName(SimdLevel level);
+
+// apply gravity, air drag and a Verlet step to the nodes [begin, end) of the store. all nodes must belong to the same rope.
+// anchored nodes are handled with masks, they keep their positions and only get their acceleration reset
+void IntegrateNodes(RopeNodeStore& store, int begin, int end, const IntegrationParams& params, SimdLevel level);
@@ -0,0 +1,214 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <atomic>
+#include <algorithm>
+#include "raylib.h"
+#include "Threadpool.h"
+
+// hashed uniform grid over points (node positions).
+// built with a parallel counting sort: every point lands in a table slot by the hash of its cell, then the points are
+// sorted by slot, so all points of a cell (and their positions) sit next to each other in memory
+class SpatialHash
+{
+public:
+
+	SpatialHash() = default;
+	~SpatialHash() = default;
+
+	// index count points, position(i) returns point i. queries are cheapest with a cellSize close to the query radius.
+	// the threads race for the places inside a slot, so the points of a slot come in a different order every build.
+	// stableOrder sorts them by index afterwards, which makes the order (and anything summed up in it) the same on every run
+	template<typename PositionFunc>
+	void Build(int count, PositionFunc&& position, float cellSize, Threadpool& threadpool, bool stableOrder = false) {
+
+		pointCount = count;
+		inverseCellSize = 1.0f / cellSize;
+
+		// about two slots per point keeps hash collisions between cells rare
+		int tableSize = 1024;
+		tableShift = 64 - 10;
+		while (tableSize < 2 * count) {
+			tableSize *= 2;
+			tableShift--;
+		}
+
+		cellStarts.assign(tableSize + 1, 0);
+		cellCursors.resize(tableSize + 1);
+		pointSlots.resize(count);
+		sortedPoints.resize(count);
+		sortedPositions.resize(count);
+
+		int blockCount = (count + BuildBlockSize - 1) / BuildBlockSize;
+
+		// count the points per slot
+		threadpool.ParralelFor(0, blockCount, [&](int block) {
+
+			int end = std::min(count, (block + 1) * BuildBlockSize);
+
+			for (int i = block * BuildBlockSize; i < end; i++) {
+
+				uint32_t slot = SlotOf(position(i));
+				pointSlots[i] = slot;
+				std::atomic_ref<uint32_t>(cellStarts[slot]).fetch_add(1, std::memory_order_relaxed);
+			}
+		});
+
+		ExclusiveScan(threadpool);
+
+		// sort the points by slot
+		std::copy(cellStarts.begin(), cellStarts.end(), cellCursors.begin());
+
+		threadpool.ParralelFor(0, blockCount, [&](int block) {
+
+			int end = std::min(count, (block + 1) * BuildBlockSize);
+
+			for (int i = block * BuildBlockSize; i < end; i++) {
+
+				uint32_t index = std::atomic_ref<uint32_t>(cellCursors[pointSlots[i]]).fetch_add(1, std::memory_order_relaxed);
+				sortedPoints[index] = i;
+				sortedPositions[index] = position(i);
+			}
+		});
+
+		if (!stableOrder) return;
+
+		int slotCount = tableSize;
+		int slotBlockCount = (slotCount + BuildBlockSize - 1) / BuildBlockSize;
+
+		threadpool.ParralelFor(0, slotBlockCount, [&](int block) {
+
+			int end = std::min(slotCount, (block + 1) * BuildBlockSize);
+
+			for (int slot = block * BuildBlockSize; slot < end; slot++) {
+
+				uint32_t first = cellStarts[slot];
+				uint32_t last = cellStarts[slot + 1];
+				if (last - first < 2) continue;
+
+				std::sort(sortedPoints.begin() + first, sortedPoints.begin() + last);
+				for (uint32_t s = first; s < last; s++) {
+					sortedPositions[s] = position(sortedPoints[s]);
+				}
+			}
+		});
+	}
+
+	// call func(pointIndex, position) for every point in the cells touched by the circle. that includes points up to
+	// about one cell outside of it (and rarely points of other cells that share a slot), so func has to check the distance itself.
+	// every point is visited once, unless the circle covers more than MaxDedupedCells cells
+	template<typename Func>
+	void ForEachNear(Vector2 point, float radius, Func&& func) const {
+
+		ForEachSortedNear(point, radius, [&](int sortedIndex) {
+			func((int)sortedPoints[sortedIndex], sortedPositions[sortedIndex]);
+		});
+	}
+
+	// same as ForEachNear, but passes the index into SortedPoints(). lets callers keep their own per-point data in sorted order
+	template<typename Func>
+	void ForEachSortedNear(Vector2 point, float radius, Func&& func) const {
+
+		if (pointCount == 0) return;
+
+		int minX = CellCoord(point.x - radius);
+		int maxX = CellCoord(point.x + radius);
+		int minY = CellCoord(point.y - radius);
+		int maxY = CellCoord(point.y + radius);
+
+		// slots already visited by this query, two of its cells can hash to the same one
+		uint32_t visitedSlots[MaxDedupedCells];
+		int visitedCount = 0;
+
+		for (int cellY = minY; cellY <= maxY; cellY++) {
+			for (int cellX = minX; cellX <= maxX; cellX++) {
+
+				uint32_t slot = SlotOfCell(cellX, cellY);
+
+				if (std::find(visitedSlots, visitedSlots + visitedCount, slot) != visitedSlots + visitedCount) continue;
+				if (visitedCount < MaxDedupedCells) visitedSlots[visitedCount++] = slot;
+
+				for (uint32_t s = cellStarts[slot]; s < cellStarts[slot + 1]; s++) {
+					func((int)s);
+				}
+			}
+		}
+	}
+
+	int Size() const { return pointCount; }
+	bool IsEmpty() const { return pointCount == 0; }
+
+	// points sorted by slot, and their positions at build time
+	const std::vector<uint32_t>& SortedPoints() const { return sortedPoints; }
+	const std::vector<Vector2>& SortedPositions() const { return sortedPositions; }
+
+	int CellCoord(float coordinate) const { return (int)floorf(coordinate * inverseCellSize); }
+
+	// multiplicative (Fibonacci) hash of the whole cell key: the top bits of the product depend on every bit of x and y,
+	// so cells along a line spread over the entire table instead of piling up in a few slots.
+	// cells far apart can still share a slot, which only costs a few extra distance checks
+	uint32_t SlotOfCell(int cellX, int cellY) const {
+
+		uint64_t key = ((uint64_t)(uint32_t)cellX << 32) | (uint32_t)cellY;
+		return (uint32_t)((key * 0x9E3779B97F4A7C15ull) >> tableShift);
+	}
+
+	uint32_t SlotOf(Vector2 position) const { return SlotOfCell(CellCoord(position.x), CellCoord(position.y)); }
+
+private:
+
+	static constexpr int BuildBlockSize = 4096;
+	static constexpr int MaxDedupedCells = 32;
+
+	int pointCount = 0;
+	float inverseCellSize = 1;
+	// 64 - log2(table size), the product's top bits are the slot
+	int tableShift = 64 - 10;
+
+	// points of slot k are sortedPoints[cellStarts[k] .. cellStarts[k + 1])
+	std::vector<uint32_t> cellStarts;
+	std::vector<uint32_t> cellCursors;
+	std::vector<uint32_t> pointSlots;
+	std::vector<uint32_t> sortedPoints;
+	std::vector<Vector2> sortedPositions;
+
+	// blockSums keeps the per-block totals of the scan
+	std::vector<uint32_t> blockSums;
+
+	// turn the per-slot counts into start indices, in blocks: sum every block, scan the block sums, then scan inside the blocks
+	void ExclusiveScan(Threadpool& threadpool) {
+
+		int size = (int)cellStarts.size();
+		int blockCount = (size + BuildBlockSize - 1) / BuildBlockSize;
+		blockSums.assign(blockCount, 0);
+
+		threadpool.ParralelFor(0, blockCount, [&](int block) {
+
+			int end = std::min(size, (block + 1) * BuildBlockSize);
+			uint32_t sum = 0;
+
+			for (int i = block * BuildBlockSize; i < end; i++) sum += cellStarts[i];
+			blockSums[block] = sum;
+		});
+
+		uint32_t total = 0;
+		for (uint32_t& sum : blockSums) {
+			uint32_t blockTotal = sum;
+			sum = total;
+			total += blockTotal;
+		}
+
+		threadpool.ParralelFor(0, blockCount, [&](int block) {
+
+			int end = std::min(size, (block + 1) * BuildBlockSize);
+			uint32_t running = blockSums[block];
+
+			for (int i = block * BuildBlockSize; i < end; i++) {
+				uint32_t slotCount = cellStarts[i];
+				cellStarts[i] = running;
+				running += slotCount;
+			}
+		});
+	}
+};
@@ -0,0 +1,10 @@
+#pragma once
+#include <vector>
+
+// logical cpus in the order threads should be pinned to them. cores of the same package (socket) come next to each other,
+// and with avoidSmtSiblings every physical core gets a thread before any of their SMT siblings does.
+// only cpus this process is allowed to run on are listed
+std::vector<int> GetCpuPinningOrder(bool avoidSmtSiblings);
+
+// pin the calling thread to one logical cpu. returns false if that isn't supported or failed
+bool PinCurrentThreadToCpu(int cpu);
@@ -0,0 +1,565 @@
+#pragma once
+#include <vector>
+#include <functional>
+#include <atomic>
+#include <future>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <new>
+#include <cstddef>
+#include <type_traits>
+#include <cstdint>
+#include <memory>
+#include <algorithm>
+#include "ThreadAffinity.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+
+// a void() task stored inside the object instead of on the heap (unlike std::function).
+// the callable and its captures must fit into Capacity bytes, which is checked at compile time
+class InlineTask
+{
+public:
+
+	static constexpr size_t Capacity = 64;
+
+	InlineTask() = default;
+
+	template<typename Func> requires (!std::is_same_v<std::remove_cvref_t<Func>, InlineTask>)
+	InlineTask(Func&& func) {
+
+		using FuncType = std::decay_t<Func>;
+		static_assert(sizeof(FuncType) <= Capacity, "task captures too much to be stored inline, capture a pointer or reference instead");
+		static_assert(alignof(FuncType) <= alignof(std::max_align_t), "task is over-aligned");
+
+		new (storage) FuncType(std::forward<Func>(func));
+		invokeFn = [](void* task) { (*static_cast<FuncType*>(task))(); };
+		moveFn = [](void* destination, void* source) { new (destination) FuncType(std::move(*static_cast<FuncType*>(source))); };
+		destroyFn = [](void* task) { static_cast<FuncType*>(task)->~FuncType(); };
+	}
+
+	InlineTask(InlineTask&& other) noexcept { MoveFrom(other); }
+
+	InlineTask& operator=(InlineTask&& other) noexcept {
+
+		if (this != &other) {
+			Reset();
+			MoveFrom(other);
+		}
+		return *this;
+	}
+
+	InlineTask(const InlineTask&) = delete;
+	InlineTask& operator=(const InlineTask&) = delete;
+
+	~InlineTask() { Reset(); }
+
+	void operator()() { invokeFn(storage); }
+	explicit operator bool() const { return invokeFn != nullptr; }
+
+	void Reset() {
+
+		if (destroyFn) destroyFn(storage);
+		invokeFn = nullptr;
+		moveFn = nullptr;
+		destroyFn = nullptr;
+	}
+
+private:
+
+	alignas(std::max_align_t) unsigned char storage[Capacity];
+	void (*invokeFn)(void* task) = nullptr;
+	void (*moveFn)(void* destination, void* source) = nullptr;
+	void (*destroyFn)(void* task) = nullptr;
+
+	void MoveFrom(InlineTask& other) {
+
+		if (!other.invokeFn) return;
+
+		other.moveFn(storage, other.storage);
+		invokeFn = other.invokeFn;
+		moveFn = other.moveFn;
+		destroyFn = other.destroyFn;
+		other.Reset();
+	}
+};
+
+// non-owning reference to a void(int) callable: a context pointer and a function pointer, never allocates.
+// the callable has to outlive the reference
+class IndexFunctionRef
+{
+public:
+
+	template<typename Func> requires (!std::is_same_v<std::remove_cvref_t<Func>, IndexFunctionRef>)
+	IndexFunctionRef(Func&& func)
+		: ctx((void*)&func),
+		invokeFn([](void* context, int i) { (*static_cast<std::remove_reference_t<Func>*>(context))(i); })
+	{}
+
+	void operator()(int i) const { invokeFn(ctx, i); }
+
+	void* ctx;
+	void (*invokeFn)(void* ctx, int i);
+};
+
+
+// how the threadpool places its threads and work
+struct ThreadpoolOptions
+{
+	// workers. the thread calling ParralelFor works as well, so one less than there are cores keeps every core busy without
+	// oversubscribing them (at least one)
+	size_t threadCount = std::max(2u, std::thread::hardware_concurrency()) - 1;
+
+	// pin every worker to its own logical cpu, so the os can't migrate it (and its cache) to another core or socket.
+	// the first cpu of the pinning order is left to the thread that calls ParralelFor
+	bool pinThreads = false;
+	// also pin the thread that constructs the pool (usually the one calling ParralelFor) to that first cpu
+	bool pinCallingThread = false;
+	// give every physical core a thread before putting a second one on its SMT sibling
+	bool avoidSmtSiblings = true;
+
+	// ParralelFor starts every thread on the same part of the range on every call, so a thread keeps working on the
+	// nodes it already has in cache (and, with first touch, in its own NUMA node's memory). stealing still balances the rest
+	bool stickyChunks = true;
+};
+
+
+class Threadpool
+{
+private:
+
+	// stores threads
+	std::vector<std::thread> threads;
+
+	// stores tasks. a ring of inline tasks allocated once, so queueing a task never touches the heap
+	static constexpr int TaskRingCapacity = 1024;
+	std::vector<InlineTask> taskRing;
+	int taskRingHead = 0;
+	int taskRingCount = 0;
+
+	// a mutex and a condition variable for the taskRing
+	std::mutex queue_mtx;
+	std::condition_variable queue_cv;
+
+	// a flag used to destroy the threadpool
+	std::atomic<bool> end_Pool;
+
+	// tasks waiting in taskRing, so spinning workers can notice them without taking the mutex
+	std::atomic<int> queuedTasks{ 0 };
+
+	// a piece of a ParralelFor range. it carries the function, so whoever steals it can run it on its own
+	struct RangeTask
+	{
+		void (*invoke)(void* ctx, int i);
+		void* ctx;
+		int begin;
+		int end;
+		int grain;
+	};
+
+	// per thread deque of range tasks. the owner pushes and pops at the back, thieves steal the oldest (biggest) task from the front.
+	// ranges are only split while the deque is empty, so it stays tiny and a spin lock is enough
+	struct alignas(64) RangeDeque
+	{
+		static constexpr int Capacity = 32;
+
+		RangeTask tasks[Capacity];
+		int head = 0;
+		int tail = 0;
+		std::atomic<int> count{ 0 };
+		std::atomic_flag busy = ATOMIC_FLAG_INIT;
+
+		void Lock() { while (busy.test_and_set(std::memory_order_acquire)) CpuRelax(); }
+		void Unlock() { busy.clear(std::memory_order_release); }
+
+		bool PushBack(const RangeTask& task) {
+
+			Lock();
+			bool pushed = count.load(std::memory_order_relaxed) < Capacity;
+			if (pushed) {
+				tasks[tail] = task;
+				tail = (tail + 1) % Capacity;
+				count.fetch_add(1, std::memory_order_relaxed);
+			}
+			Unlock();
+			return pushed;
+		}
+
+		bool PopBack(RangeTask& task) {
+
+			if (count.load(std::memory_order_relaxed) == 0) return false;
+
+			Lock();
+			bool popped = count.load(std::memory_order_relaxed) > 0;
+			if (popped) {
+				tail = (tail + Capacity - 1) % Capacity;
+				task = tasks[tail];
+				count.fetch_sub(1, std::memory_order_relaxed);
+			}
+			Unlock();
+			return popped;
+		}
+
+		bool StealFront(RangeTask& task) {
+
+			if (count.load(std::memory_order_relaxed) == 0) return false;
+
+			Lock();
+			bool stolen = count.load(std::memory_order_relaxed) > 0;
+			if (stolen) {
+				task = tasks[head];
+				head = (head + 1) % Capacity;
+				count.fetch_sub(1, std::memory_order_relaxed);
+			}
+			Unlock();
+			return stolen;
+		}
+	};
+
+	ThreadpoolOptions options;
+
+	// one deque per worker, plus one for the thread calling ParralelFor (the last one)
+	std::unique_ptr<RangeDeque[]> deques;
+	int dequeCount = 0;
+
+	// persistent parallel region used by ParralelFor. bumping the generation releases the workers,
+	// the region is done once regionRemaining (indices not run yet) reaches zero
+	std::atomic<uint32_t> regionGeneration{ 0 };
+	std::atomic<int> regionRemaining{ 0 };
+
+	// workers waiting on queue_cv. the caller only takes the mutex to wake them if there are any
+	std::atomic<int> parkedWorkers{ 0 };
+
+	// how long an idle worker polls for new regions before it parks
+	static constexpr int SpinIterations = 1 << 14;
+	// ranges are cut into about this many grains per thread
+	static constexpr int GrainsPerThread = 8;
+
+	static void CpuRelax() {
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+		_mm_pause();
+#elif defined(__aarch64__)
+		__asm__ __volatile__("yield");
+#endif
+	}
+
+	// both need queue_mtx to be held
+	bool IsTaskRingFull() const { return taskRingCount == TaskRingCapacity; }
+
+	void PushTask(InlineTask&& task) {
+
+		taskRing[(taskRingHead + taskRingCount) % TaskRingCapacity] = std::move(task);
+		taskRingCount++;
+		queuedTasks.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	// run a range grain by grain. whenever our deque runs empty, the upper half of what is left goes into it,
+	// so idle threads always find big pieces to steal and ranges are only split as far as someone needs them
+	void RunRangeTask(int self, RangeTask task) {
+
+		while (task.begin < task.end) {
+
+			int size = task.end - task.begin;
+
+			if (size > task.grain && deques[self].count.load(std::memory_order_relaxed) == 0) {
+
+				RangeTask upperHalf = task;
+				upperHalf.begin = task.begin + size / 2;
+				if (deques[self].PushBack(upperHalf)) task.end = upperHalf.begin;
+			}
+
+			int grainEnd = std::min(task.begin + task.grain, task.end);
+
+			for (int i = task.begin; i < grainEnd; i++) {
+				task.invoke(task.ctx, i);
+			}
+
+			regionRemaining.fetch_sub(grainEnd - task.begin, std::memory_order_release);
+			task.begin = grainEnd;
+		}
+	}
+
+	bool StealTask(int self, uint32_t& random, RangeTask& task) {
+
+		for (int attempt = 0; attempt < dequeCount; attempt++) {
+
+			// xorshift, victims are picked at random so thieves don't all line up at the same deque
+			random ^= random << 13;
+			random ^= random >> 17;
+			random ^= random << 5;
+
+			int victim = random % dequeCount;
+			if (victim != self && deques[victim].StealFront(task)) return true;
+		}
+		return false;
+	}
+
+	// work on the current region (our own deque first, then steal) until all of it is done
+	void RunRegion(int self) {
+
+		uint32_t random = 2654435761u * (self + 1);
+
+		for (int idle = 0;; idle++) {
+
+			RangeTask task;
+
+			if (deques[self].PopBack(task) || StealTask(self, random, task)) {
+				RunRangeTask(self, task);
+				idle = 0;
+				continue;
+			}
+
+			if (regionRemaining.load(std::memory_order_acquire) == 0) return;
+
+			// the last grains are still running somewhere else. give the cpu away now and then in case that thread is waiting for it
+			if ((idle & 63) == 63) std::this_thread::yield();
+			else CpuRelax();
+		}
+	}
+
+	void WorkerLoop(int self) {
+
+		uint32_t seenGeneration = 0;
+
+		for (;;) {
+
+			// stay hot for a while: parallel regions usually come in quick succession (several per sub-step)
+			bool hasQueuedTask = false;
+
+			for (int spin = 0; spin < SpinIterations; spin++) {
+
+				uint32_t generation = regionGeneration.load(std::memory_order_acquire);
+
+				if (generation != seenGeneration) {
+					seenGeneration = generation;
+					RunRegion(self);
+					spin = 0;
+					continue;
+				}
+
+				if (queuedTasks.load(std::memory_order_relaxed) > 0 || end_Pool.load()) {
+					hasQueuedTask = true;
+					break;
+				}
+
+				if ((spin & 63) == 63) std::this_thread::yield();
+				else CpuRelax();
+			}
+
+			InlineTask task;
+
+			{
+				// put threads to sleep if no tasks or regions are available
+				std::unique_lock<std::mutex> lock(queue_mtx);
+
+				if (!hasQueuedTask) {
+					parkedWorkers.fetch_add(1);
+					queue_cv.wait(lock, [&] {return taskRingCount > 0 || end_Pool.load() == true || regionGeneration.load() != seenGeneration; });
+					parkedWorkers.fetch_sub(1);
+				}
+
+				//break the cycle if we wish to end the threadpool
+				if (end_Pool.load() == true && taskRingCount == 0) {
+					return;
+				}
+
+				// a new region (or another worker took the task), go back to the hot loop
+				if (taskRingCount == 0) continue;
+
+				// get a task from the queue
+				task = std::move(taskRing[taskRingHead]);
+				// delite a task from the queue
+				taskRingHead = (taskRingHead + 1) % TaskRingCapacity;
+				taskRingCount--;
+				queuedTasks.fetch_sub(1, std::memory_order_relaxed);
+			}
+
+			//perform the task
+			task();
+		}
+	}
+
+
+public:
+
+	int ThreadCount;
+
+	Threadpool(size_t threadAmount)
+		: Threadpool(ThreadpoolOptions{ threadAmount })
+	{}
+
+	Threadpool(const ThreadpoolOptions& poolOptions)
+		: options(poolOptions), ThreadCount((int)poolOptions.threadCount)
+	{
+		// initialize end flag
+		end_Pool.store(false);
+
+		taskRing.resize(TaskRingCapacity);
+
+		size_t threadAmount = options.threadCount;
+
+		dequeCount = (int)threadAmount + 1;
+		deques = std::make_unique<RangeDeque[]>(dequeCount);
+
+		std::vector<int> cpus;
+		if (options.pinThreads) cpus = GetCpuPinningOrder(options.avoidSmtSiblings);
+
+		if (options.pinThreads && options.pinCallingThread && !cpus.empty()) {
+			PinCurrentThreadToCpu(cpus[0]);
+		}
+
+		for (size_t i = 0; i < threadAmount; ++i)
+		{
+			// worker i gets the cpu after the calling thread's one, wrapping around if there are more threads than cpus
+			int cpu = cpus.empty() ? -1 : cpus[(i + 1) % cpus.size()];
+
+			// fill the threads vector
+			threads.emplace_back([this, i, cpu] {
+
+				if (cpu >= 0) PinCurrentThreadToCpu(cpu);
+				WorkerLoop((int)i);
+			});
+		}
+	};
+
+	// a destructor
+	~Threadpool() {
+
+		{
+			std::lock_guard<std::mutex> lock(queue_mtx);
+			end_Pool = true;
+		}
+
+		// wake up all threads
+		queue_cv.notify_all();
+
+		// join the threads
+		for (std::thread& t : threads) {
+
+			if (t.joinable()) {
+				t.join();
+			}
+		}
+	};
+
+	//add new tasks to the queue. fire and forget. if the queue is full, the task runs right away on the calling thread
+	template<typename Func, typename... Args>
+	void EnQueue(Func&& func, Args&&... args) {
+
+		//create a task
+		InlineTask task([func = std::move(func), args...]() {
+			func(args...);
+			});
+
+		bool isQueued = false;
+
+		{
+			std::lock_guard<std::mutex>lock(queue_mtx);
+
+			// push the task
+			if (!IsTaskRingFull()) {
+				PushTask(std::move(task));
+				isQueued = true;
+			}
+		}
+
+		if (!isQueued) {
+			task();
+			return;
+		}
+		// wake up one thread to perform the task
+		queue_cv.notify_one();
+	};
+
+
+	// put multiple tasks to the tasks queue ONCE. tasks that don't fit into the queue run on the calling thread
+	template<typename Func>
+	void EnqueueBatch(std::vector<Func>& tasks)
+	{
+		if (tasks.empty()) return;
+
+		size_t pushed = 0;
+
+		{
+			// Lock once
+			std::lock_guard<std::mutex> lock(queue_mtx);
+
+			// Move all tasks into the queue while holding the lock
+			for (; pushed < tasks.size() && !IsTaskRingFull(); pushed++) {
+				PushTask(InlineTask(std::move(tasks[pushed])));
+			}
+		}
+
+		// Notify all sleeping threads to wake up and grab work
+		// We don't know exactly how many to notify, so wake everyone (fast enough)
+		queue_cv.notify_all();
+
+		for (; pushed < tasks.size(); pushed++) {
+			tasks[pushed]();
+		}
+	}
+
+	//split the job across the workers and the calling thread. threads that run out of work steal from the others,
+	//so uneven indices (a 10k node rope next to hundreds of short ones) still keep every thread busy.
+	//runs as a persistent parallel region: no allocation, no task queue and no mutex unless a worker has parked.
+	//only one thread may run a ParralelFor at a time
+	template<typename Func>
+	void ParralelFor(int startIndex, int endIndex, Func&& func) {
+
+		ParralelFor(startIndex, endIndex, IndexFunctionRef(func));
+	}
+
+	//same as above for a callable that is already type erased. func has to stay alive until ParralelFor returns (it always does)
+	void ParralelFor(int startIndex, int endIndex, IndexFunctionRef func) {
+
+		int totalIndecies = (endIndex - startIndex);
+		if (totalIndecies <= 0) return;
+
+		// nothing to share, skip waking the workers
+		if (totalIndecies == 1 || threads.empty()) {
+			for (int i = startIndex; i < endIndex; i++) func(i);
+			return;
+		}
+
+		RangeTask region;
+		region.invoke = func.invokeFn;
+		region.ctx = func.ctx;
+		region.begin = startIndex;
+		region.end = endIndex;
+		region.grain = std::max(1, totalIndecies / (dequeCount * GrainsPerThread));
+
+		int self = dequeCount - 1;
+		regionRemaining.store(totalIndecies, std::memory_order_relaxed);
+
+		if (options.stickyChunks) {
+
+			// every thread starts on its own equal part, the same one on every call over the same range
+			for (int t = 0; t < dequeCount; t++) {
+
+				RangeTask chunk = region;
+				chunk.begin = startIndex + (int)((long long)totalIndecies * t / dequeCount);
+				chunk.end = startIndex + (int)((long long)totalIndecies * (t + 1) / dequeCount);
+				if (chunk.begin < chunk.end) deques[t].PushBack(chunk);
+			}
+		}
+		else {
+
+			// the whole range starts in the caller's deque, the workers steal their share from there
+			deques[self].PushBack(region);
+		}
+
+		regionGeneration.fetch_add(1);
+
+		// spinning workers see the new generation by themselves, parked ones need a notify
+		if (parkedWorkers.load() > 0) {
+			std::lock_guard<std::mutex> lock(queue_mtx);
+			queue_cv.notify_all();
+		}
+
+		RunRegion(self);
+	}
+};
\ No newline at end of file
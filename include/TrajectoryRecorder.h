@@ -0,0 +1,130 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <cstdint>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include "RopeNode.h"
+#include "Threadpool.h"
+
+// file layout: TrajectoryFileHeader, then one chunk per recorded frame: TrajectoryFrameHeader followed by payloadBytes of Rice coded values.
+// a frame holds the x of every node and then the y, each quantized to 'precision' and stored as the difference to where the
+// node was predicted from the two frames before (zigzag mapped, so small negative differences stay small). keyframes store the
+// quantized positions themselves, they start the file, come every keyframeInterval frames and whenever the node count changes
+constexpr char TrajectoryMagic[8] = { 'R', 'O', 'P', 'E', 'T', 'R', 'A', 'J' };
+constexpr uint32_t TrajectoryVersion = 1;
+// values per Rice parameter. every block of this many values gets its own parameter, stored in 5 bits in front of it
+constexpr int TrajectoryBlockSize = 256;
+
+struct TrajectoryFileHeader
+{
+	char magic[8];
+	uint32_t version;
+	float precision;
+};
+
+struct TrajectoryFrameHeader
+{
+	uint32_t frameIndex;
+	uint32_t nodeCount;
+	uint32_t isKeyframe;
+	uint32_t payloadBytes;
+};
+
+struct TrajectoryRecorderOptions
+{
+	// quantization step in world units. positions come back within precision / 2
+	float precision = 0.01f;
+	int keyframeInterval = 600;
+	// frames waiting for the background thread. when they are all taken, recording the next frame waits for one to be written
+	int maxQueuedFrames = 8;
+};
+
+// records node positions every step (RopePhysicsSolver::Recorder). the solver thread only quantizes and takes the differences,
+// in parallel on the threadpool, the entropy coding and the file writes happen on a background thread
+class TrajectoryRecorder
+{
+public:
+
+	TrajectoryRecorder() = default;
+	~TrajectoryRecorder() { Close(); }
+
+	TrajectoryRecorder(const TrajectoryRecorder&) = delete;
+	TrajectoryRecorder& operator=(const TrajectoryRecorder&) = delete;
+
+	// create the file and start the background thread. returns false if the file can't be created or precision isn't above 0
+	bool Open(const char* path, const TrajectoryRecorderOptions& options = {});
+	// write everything still queued and close the file. returns false if any write failed, the file is incomplete then
+	bool Close();
+	// false once a write failed (disk full, ...), the following frames aren't recorded any more
+	bool IsOpen() const { return writerThread.joinable() && !writeFailed.load(std::memory_order_relaxed); }
+
+	void RecordFrame(const RopeNode* nodes, int nodeCount, Threadpool& threadpool);
+
+	uint64_t FramesRecorded() const { return frameIndex; }
+	uint64_t BytesWritten() const { return bytesWritten.load(std::memory_order_relaxed); }
+	// how often RecordFrame had to wait for the background thread
+	uint64_t QueueStalls() const { return queueStalls; }
+
+private:
+
+	struct QueuedFrame
+	{
+		TrajectoryFrameHeader header;
+		std::vector<uint32_t> values;	// zigzag mapped differences, all x first, then all y
+	};
+
+	TrajectoryRecorderOptions options;
+	std::ofstream file;
+
+	// quantized positions of the last two recorded frames, x and y interleaved
+	std::vector<int32_t> previousPositions;
+	std::vector<int32_t> olderPositions;
+	int framesSinceKeyframe = 0;
+	uint32_t frameIndex = 0;
+	uint64_t queueStalls = 0;
+	std::atomic<uint64_t> bytesWritten = 0;
+	std::atomic<bool> writeFailed = false;
+
+	// frames are reused: taken from freeFrames, filled, queued, written and given back
+	std::vector<QueuedFrame> frames;
+	std::vector<QueuedFrame*> freeFrames;
+	std::deque<QueuedFrame*> queuedFrames;
+	std::mutex queueMutex;
+	std::condition_variable queueCondition;
+	bool isClosing = false;
+	std::thread writerThread;
+
+	static constexpr int QuantizeBlockSize = 4096;
+
+	void WriterLoop();
+};
+
+// reads a file written by TrajectoryRecorder frame by frame
+class TrajectoryReader
+{
+public:
+
+	// returns false if the file can't be opened or isn't a trajectory
+	bool Open(const char* path);
+
+	// positions of the next frame. returns false at the end of the file or on a damaged frame
+	bool ReadFrame(std::vector<Vector2>& positions);
+
+	float Precision() const { return precision; }
+	uint32_t FrameIndex() const { return frameIndex; }
+
+private:
+
+	std::ifstream file;
+	float precision = 1;
+	uint32_t frameIndex = 0;
+	int framesSinceKeyframe = 0;
+	std::vector<int32_t> previousPositions;
+	std::vector<int32_t> olderPositions;
+	std::vector<uint8_t> payload;
+	std::vector<uint32_t> values;
+};
@@ -16,4 +16,16 @@ void CameraMove(Camera2D& mainCamera)
 		mainCamera.target.y -= mouseDelta.y / mainCamera.zoom;
 	}
 
+}
+
+InteractionInput ReadInteractionInput(const Camera2D& mainCamera)
+{
+	InteractionInput input;
+
+	input.cursorWorldPos = GetScreenToWorld2D(GetMousePosition(), mainCamera);
+	input.dragHeld = IsMouseButtonDown(MOUSE_BUTTON_LEFT);
+	input.dragReleased = IsMouseButtonReleased(MOUSE_BUTTON_LEFT);
+	input.toggleAnchorPressed = IsKeyPressed(KEY_LEFT_CONTROL);
+
+	return input;
 }
\ No newline at end of file
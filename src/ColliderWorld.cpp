@@ -0,0 +1,179 @@
+#include "ColliderWorld.h"
+#include <algorithm>
+#include <cmath>
+
+void ColliderWorld::AddSegment(Vector2 a, Vector2 b) {
+
+	Add({ ColliderShape::Segment, a, b, 0, Vector2Min(a, b), Vector2Max(a, b) });
+}
+
+void ColliderWorld::AddBox(Vector2 min, Vector2 max) {
+
+	Vector2 boxMin = Vector2Min(min, max);
+	Vector2 boxMax = Vector2Max(min, max);
+	Add({ ColliderShape::Box, boxMin, boxMax, 0, boxMin, boxMax });
+}
+
+void ColliderWorld::AddCircle(Vector2 center, float radius) {
+
+	Add({ ColliderShape::Circle, center, center, radius, center - Vector2{ radius, radius }, center + Vector2{ radius, radius } });
+}
+
+void ColliderWorld::AddPolyline(const std::vector<Vector2>& points, bool closed) {
+
+	for (size_t i = 1; i < points.size(); i++) {
+		AddSegment(points[i - 1], points[i]);
+	}
+
+	if (closed && points.size() > 2) {
+		AddSegment(points.back(), points.front());
+	}
+}
+
+void ColliderWorld::Clear() {
+
+	colliders.clear();
+	nodes.clear();
+	isDirty = false;
+}
+
+void ColliderWorld::Add(const Collider& collider) {
+
+	colliders.push_back(collider);
+	isDirty = true;
+}
+
+void ColliderWorld::Update() {
+
+	if (!isDirty) return;
+
+	nodes.clear();
+	nodes.reserve(2 * colliders.size());
+
+	if (!colliders.empty()) {
+		nodes.push_back({});
+		BuildNode(0, 0, colliders.size(), 0);
+	}
+
+	isDirty = false;
+}
+
+// fill node nodeIndex over colliders [first, first + count). colliders are reordered in place,
+// split at the median of the longer axis of their centers, so the tree stays balanced for any layout
+void ColliderWorld::BuildNode(int nodeIndex, int first, int count, int depth) {
+
+	Vector2 boundsMin = colliders[first].boundsMin;
+	Vector2 boundsMax = colliders[first].boundsMax;
+	Vector2 centerMin = (boundsMin + boundsMax) * 0.5f;
+	Vector2 centerMax = centerMin;
+
+	for (int c = first; c < first + count; c++) {
+
+		boundsMin = Vector2Min(boundsMin, colliders[c].boundsMin);
+		boundsMax = Vector2Max(boundsMax, colliders[c].boundsMax);
+
+		Vector2 center = (colliders[c].boundsMin + colliders[c].boundsMax) * 0.5f;
+		centerMin = Vector2Min(centerMin, center);
+		centerMax = Vector2Max(centerMax, center);
+	}
+
+	nodes[nodeIndex].boundsMin = boundsMin;
+	nodes[nodeIndex].boundsMax = boundsMax;
+
+	// the query stack holds at most one entry per level (plus one), so stop splitting before it could overflow
+	if (count <= LeafSize || depth >= MaxDepth - 2) {
+		nodes[nodeIndex].first = first;
+		nodes[nodeIndex].count = count;
+		return;
+	}
+
+	bool splitX = centerMax.x - centerMin.x >= centerMax.y - centerMin.y;
+	int half = count / 2;
+
+	std::nth_element(colliders.begin() + first, colliders.begin() + first + half, colliders.begin() + first + count,
+		[&](const Collider& a, const Collider& b) {
+			return splitX ? a.boundsMin.x + a.boundsMax.x < b.boundsMin.x + b.boundsMax.x
+				: a.boundsMin.y + a.boundsMax.y < b.boundsMin.y + b.boundsMax.y;
+		});
+
+	// both children next to each other
+	int left = nodes.size();
+	nodes[nodeIndex].first = left;
+	nodes[nodeIndex].count = 0;
+	nodes.push_back({});
+	nodes.push_back({});
+
+	BuildNode(left, first, half, depth + 1);
+	BuildNode(left + 1, first + half, count - half, depth + 1);
+}
+
+bool ColliderWorld::Resolve(int colliderIndex, Vector2 position, float radius, Vector2& push) const {
+
+	const Collider& collider = colliders[colliderIndex];
+
+	switch (collider.shape) {
+
+	case ColliderShape::Circle: {
+
+		Vector2 offset = position - collider.a;
+		float distance = Vector2Length(offset);
+		float minDistance = collider.radius + radius;
+
+		if (distance >= minDistance) return false;
+
+		// exactly in the center, push up
+		Vector2 normal = distance > 0 ? offset / distance : Vector2{ 0, -1 };
+		push = normal * (minDistance - distance);
+		return true;
+	}
+
+	case ColliderShape::Segment: {
+
+		Vector2 segment = collider.b - collider.a;
+		float lengthSqr = Vector2LengthSqr(segment);
+		float t = lengthSqr > 0 ? std::clamp(Vector2DotProduct(position - collider.a, segment) / lengthSqr, 0.0f, 1.0f) : 0.0f;
+
+		Vector2 offset = position - (collider.a + segment * t);
+		float distance = Vector2Length(offset);
+
+		if (distance >= radius) return false;
+
+		// on the line, push along its normal
+		Vector2 normal = distance > 0 ? offset / distance : Vector2Normalize(Vector2{ -segment.y, segment.x });
+		push = normal * (radius - distance);
+		return true;
+	}
+
+	case ColliderShape::Box: {
+
+		Vector2 closest = Vector2Clamp(position, collider.a, collider.b);
+		Vector2 offset = position - closest;
+		float distanceSqr = Vector2LengthSqr(offset);
+
+		// outside, push away from the closest point
+		if (distanceSqr > 0) {
+
+			if (distanceSqr >= radius * radius) return false;
+
+			float distance = sqrtf(distanceSqr);
+			push = offset * ((radius - distance) / distance);
+			return true;
+		}
+
+		// inside, push out through the nearest side
+		float left = position.x - collider.a.x;
+		float right = collider.b.x - position.x;
+		float top = position.y - collider.a.y;
+		float bottom = collider.b.y - position.y;
+		float nearest = std::min(std::min(left, right), std::min(top, bottom));
+
+		if (nearest == left) push = { -(left + radius), 0 };
+		else if (nearest == right) push = { right + radius, 0 };
+		else if (nearest == top) push = { 0, -(top + radius) };
+		else push = { 0, bottom + radius };
+		return true;
+	}
+	}
+
+	return false;
+}
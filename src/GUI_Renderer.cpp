@@ -1,5 +1,6 @@
 ﻿#include "GUI_Renderer.h"
 #include "RopePhysicsSolver.h"
+#include "InputLog.h"
 #define RAYGUI_IMPLEMENTATION
 #include "raygui.h" 
 
@@ -8,6 +9,10 @@ void GUI_Renderer::Render_GUI() {
     // draw fps at the top left corner of the screen
     DrawFPS(RelativeToScreen({ 0.02f, 0 }).x, RelativeToScreen({ 0, 0.01 }).y);
 
+    // constraint iterations the solver actually needed last frame (ropes at rest stop early)
+    DrawText(TextFormat("%i constraint iterations", Solver.LastFrameIterations), RelativeToScreen({ 0.02f, 0 }).x, RelativeToScreen({ 0, 0.045 }).y, 20, LIME);
+    DrawText(TextFormat("%i substeps", Solver.LastSubsteps), RelativeToScreen({ 0.02f, 0 }).x, RelativeToScreen({ 0, 0.075 }).y, 20, LIME);
+
     RenderPanel(0.73, 0.05, 0.25, 0.9); //create he Toolbox panel at relative to the screen position
 }
 
@@ -305,6 +310,15 @@ void GUI_Renderer::RenderPanel(float xPos, float yPos, float length, float heigh
         if (GuiButton(createNewRope, "create Rope")) {
 
             Solver.SetupRope({ (float)NewPosX, (float)NewPosY }, true, NewNodesAmount, NewNodesLength, NewNodesRadius);
+            if (Solver.InputLog) Solver.InputLog->RecordSetupRope({ (float)NewPosX, (float)NewPosY }, true, NewNodesAmount, NewNodesLength, NewNodesRadius);
+        }
+
+        Rectangle removeLastRope = SetBoundsRelative(0.55, 0.955, 0.4, 0.04, PanelBounds);
+
+        if (GuiButton(removeLastRope, "remove last Rope") && !Solver.AllRopes.empty()) {
+
+            if (Solver.InputLog) Solver.InputLog->RecordRemoveRope(Solver.AllRopes.size() - 1);
+            Solver.RemoveRope(Solver.AllRopes.size() - 1);
         }
 
     }
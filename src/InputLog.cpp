@@ -0,0 +1,242 @@
+#include "InputLog.h"
+#include "RopePhysicsSolver.h"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <type_traits>
+
+// the physics settings are written and read back as raw bytes
+static_assert(std::is_trivially_copyable_v<PhysicsConfig>);
+
+uint64_t HashNodeState(const RopeNode* nodes, int nodeCount) {
+
+	// FNV-1a over the bits of every coordinate
+	uint64_t hash = 14695981039346656037ull;
+
+	for (int i = 0; i < nodeCount; i++) {
+
+		float values[4] = { nodes[i].Position.x, nodes[i].Position.y, nodes[i].OldPosition.x, nodes[i].OldPosition.y };
+
+		for (float value : values) {
+			hash = (hash ^ std::bit_cast<uint32_t>(value)) * 1099511628211ull;
+		}
+	}
+
+	return hash;
+}
+
+bool InputRecorder::Open(const char* path, RopePhysicsSolver& solver) {
+
+	Close();
+
+	// the scene goes through memory, the solver reloads it from there
+	std::ostringstream sceneStream(std::ios::binary);
+	if (!solver.SaveSnapshot(sceneStream)) return false;
+	std::string scene = sceneStream.str();
+
+	file.open(path, std::ios::binary | std::ios::trunc);
+	if (!file) return false;
+
+	InputLogHeader header = {};
+	std::copy(std::begin(InputLogMagic), std::end(InputLogMagic), header.magic);
+	header.version = InputLogVersion;
+	header.byteOrderMark = SnapshotByteOrderMark;
+	header.physicsSize = sizeof(PhysicsConfig);
+	header.frameSize = sizeof(InputLogFrame);
+	header.snapshotOffset = (sizeof(InputLogHeader) + SnapshotAlignment - 1) / SnapshotAlignment * SnapshotAlignment;
+	header.snapshotSize = scene.size();
+
+	static const char padding[SnapshotAlignment] = {};
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(padding, header.snapshotOffset - sizeof(header));
+	file.write(scene.data(), scene.size());
+
+	if (!file.good() || !solver.LoadSnapshot(reinterpret_cast<const uint8_t*>(scene.data()), scene.size())) {
+		file.close();
+		return false;
+	}
+
+	framesRecorded = 0;
+	WriteSettings(solver.config, true);
+	file.flush();
+
+	return true;
+}
+
+void InputRecorder::Close() {
+
+	if (file.is_open()) file.close();
+}
+
+void InputRecorder::RecordFrame(const RopePhysicsSolver& solver, const InteractionInput& input, int substeps, int iterations, double frameTime) {
+
+	if (!IsOpen()) return;
+
+	// the GUI changes settings between frames, so whatever is set now was used by this frame
+	WriteSettings(solver.config, false);
+
+	InputLogFrame frame = {};
+	frame.frameTime = frameTime;
+	frame.cursorX = input.cursorWorldPos.x;
+	frame.cursorY = input.cursorWorldPos.y;
+	frame.buttons = (input.dragHeld ? InputLogDragHeld : 0) | (input.dragReleased ? InputLogDragReleased : 0) |
+		(input.toggleAnchorPressed ? InputLogToggleAnchor : 0);
+	frame.substeps = substeps;
+	frame.iterations = iterations;
+	frame.stateHash = HashNodeState(solver.AllNodes.data(), solver.AllNodes.size());
+
+	WriteRecord(InputLogRecordType::Frame, &frame, sizeof(frame));
+	framesRecorded++;
+
+	// the log is needed most after a crash, so nothing is left waiting in the stream's buffer
+	file.flush();
+}
+
+void InputRecorder::RecordSetupRope(Vector2 firstNodePos, bool isFirstNodeAnchored, int nodeAmount, float ropeLengthForEach, float nodeRadius) {
+
+	if (!IsOpen()) return;
+
+	InputLogRope rope = { firstNodePos.x, firstNodePos.y, (uint32_t)isFirstNodeAnchored, nodeAmount, ropeLengthForEach, nodeRadius };
+	WriteRecord(InputLogRecordType::SetupRope, &rope, sizeof(rope));
+}
+
+void InputRecorder::RecordRemoveRope(int ropeID) {
+
+	if (!IsOpen()) return;
+
+	int32_t id = ropeID;
+	WriteRecord(InputLogRecordType::RemoveRope, &id, sizeof(id));
+}
+
+void InputRecorder::WriteRecord(InputLogRecordType type, const void* payload, uint32_t size) {
+
+	InputLogRecord record = { type, size };
+	file.write(reinterpret_cast<const char*>(&record), sizeof(record));
+	file.write(static_cast<const char*>(payload), size);
+}
+
+// compared and copied as bytes, so padding can't make two equal settings look different
+void InputRecorder::WriteSettings(const Config& config, bool force) {
+
+	if (force || std::memcmp(&config.physics, &lastPhysics, sizeof(PhysicsConfig)) != 0) {
+
+		std::memcpy(&lastPhysics, &config.physics, sizeof(PhysicsConfig));
+		WriteRecord(InputLogRecordType::Physics, &config.physics, sizeof(PhysicsConfig));
+	}
+
+	if (force || config.interaction.canDrag != lastCanDrag) {
+
+		lastCanDrag = config.interaction.canDrag;
+		InputLogInteraction interaction = { (uint32_t)lastCanDrag };
+		WriteRecord(InputLogRecordType::Interaction, &interaction, sizeof(interaction));
+	}
+}
+
+bool InputReplayer::Open(const char* path, RopePhysicsSolver& solver) {
+
+	if (!file.Open(path) || file.Size() < sizeof(InputLogHeader)) return false;
+
+	InputLogHeader header;
+	std::memcpy(&header, file.Data(), sizeof(header));
+
+	if (!std::equal(std::begin(InputLogMagic), std::end(InputLogMagic), header.magic) || header.version != InputLogVersion ||
+		header.byteOrderMark != SnapshotByteOrderMark || header.physicsSize != sizeof(PhysicsConfig) ||
+		header.frameSize != sizeof(InputLogFrame) || header.snapshotOffset > file.Size() ||
+		header.snapshotSize > file.Size() - header.snapshotOffset) {
+		return false;
+	}
+
+	if (!solver.LoadSnapshot(file.Data() + header.snapshotOffset, header.snapshotSize)) return false;
+
+	readOffset = header.snapshotOffset + header.snapshotSize;
+	framesReplayed = 0;
+	firstDivergedFrame = -1;
+
+	return true;
+}
+
+bool InputReplayer::ReplayFrame(RopePhysicsSolver& solver) {
+
+	while (readOffset + sizeof(InputLogRecord) <= file.Size()) {
+
+		InputLogRecord record;
+		std::memcpy(&record, file.Data() + readOffset, sizeof(record));
+
+		// a log cut off by a crash ends with a partial record
+		if (record.size > file.Size() - readOffset - sizeof(record)) return false;
+
+		const uint8_t* payload = file.Data() + readOffset + sizeof(record);
+		readOffset += sizeof(record) + record.size;
+
+		switch (record.type) {
+
+		case InputLogRecordType::Physics: {
+
+			if (record.size != sizeof(PhysicsConfig)) return false;
+			std::memcpy(&solver.config.physics, payload, sizeof(PhysicsConfig));
+			break;
+		}
+
+		case InputLogRecordType::Interaction: {
+
+			InputLogInteraction interaction;
+			if (record.size != sizeof(interaction)) return false;
+			std::memcpy(&interaction, payload, sizeof(interaction));
+
+			solver.config.interaction.canDrag = interaction.canDrag != 0;
+			break;
+		}
+
+		case InputLogRecordType::SetupRope: {
+
+			InputLogRope rope;
+			if (record.size != sizeof(rope)) return false;
+			std::memcpy(&rope, payload, sizeof(rope));
+			if (rope.nodeAmount < 1) return false;
+
+			solver.SetupRope(Vector2{ rope.firstNodeX, rope.firstNodeY }, rope.isFirstNodeAnchored != 0, rope.nodeAmount, rope.ropeLengthForEach, rope.nodeRadius);
+			break;
+		}
+
+		case InputLogRecordType::RemoveRope: {
+
+			int32_t ropeID;
+			if (record.size != sizeof(ropeID)) return false;
+			std::memcpy(&ropeID, payload, sizeof(ropeID));
+			if (ropeID < 0 || ropeID >= (int)solver.AllRopes.size()) return false;
+
+			solver.RemoveRope(ropeID);
+			break;
+		}
+
+		case InputLogRecordType::Frame: {
+
+			InputLogFrame frame;
+			if (record.size != sizeof(frame)) return false;
+			std::memcpy(&frame, payload, sizeof(frame));
+
+			InteractionInput input;
+			input.cursorWorldPos = Vector2{ frame.cursorX, frame.cursorY };
+			input.dragHeld = (frame.buttons & InputLogDragHeld) != 0;
+			input.dragReleased = (frame.buttons & InputLogDragReleased) != 0;
+			input.toggleAnchorPressed = (frame.buttons & InputLogToggleAnchor) != 0;
+
+			solver.HandleRopes(input, frame.substeps, frame.iterations, frame.frameTime);
+
+			if (firstDivergedFrame == -1 && HashNodeState(solver.AllNodes.data(), solver.AllNodes.size()) != frame.stateHash) {
+				firstDivergedFrame = framesReplayed;
+			}
+
+			framesReplayed++;
+			return true;
+		}
+
+		default:
+			return false;
+		}
+	}
+
+	return false;
+}
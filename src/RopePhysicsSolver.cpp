@@ -1,6 +1,14 @@
 ﻿#include "RopePhysicsSolver.h"
 #include<iostream>
 #include <chrono>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <type_traits>
+#include "MappedFile.h"
+#include "InputLog.h"
 
 //adds acceleration that resets every frame to a node
 void RopePhysicsSolver::Accelerate(RopeNode& ropenode, const Vector2 acceleration) {
@@ -56,224 +64,1667 @@ void RopePhysicsSolver::UpdateRopeNodePosition(RopeNode& node, Rope& rope, const
 
 }
 
+// integrate the store nodes [begin, end). the range is split at rope boundaries, because the drag depends on the rope
+void RopePhysicsSolver::IntegrateNodeStoreRange(int begin, int end, const double deltaTime) {
+
+	SimdLevel level = config.physics.useSimdIntegration ? simdLevel : SimdLevel::Scalar;
+
+	while (begin < end) {
+
+		Rope& thisRope = AllRopes[NodeStore.ropeID[begin]];
+		int ropeEnd = thisRope.startNodeIndex + thisRope.nodeAmount;
+		int segmentEnd = ropeEnd < end ? ropeEnd : end;
+
+		if (thisRope.isSleeping) {
+			begin = segmentEnd;
+			continue;
+		}
+
+		IntegrationParams params;
+		params.deltaTime = deltaTime;
+		params.g = config.physics.g;
+		params.dragConstant = 0.5f * config.physics.airDensity * config.physics.dragCoef * thisRope.RopeLengthForEach;
+
+		IntegrateNodes(NodeStore, begin, segmentEnd, params, level);
+
+		begin = segmentEnd;
+	}
+}
+
+Vector2 RopePhysicsSolver::GetNodePosition(int i) const {
+
+	if (UsesNodeStore()) {
+		return Vector2{ NodeStore.x[i], NodeStore.y[i] };
+	}
+	return AllNodes[i].Position;
+}
+
+Vector2 RopePhysicsSolver::GetNodeOldPosition(int i) const {
+
+	if (UsesNodeStore()) {
+		return Vector2{ NodeStore.oldX[i], NodeStore.oldY[i] };
+	}
+	return AllNodes[i].OldPosition;
+}
+
+bool RopePhysicsSolver::IsNodeAnchored(int i) const {
+
+	if (UsesNodeStore()) {
+		return NodeStore.IsAnchored(i);
+	}
+	return AllNodes[i].IsAnchored;
+}
+
+void RopePhysicsSolver::OffsetNode(int i, const Vector2 positionOffset, const Vector2 oldPositionOffset) {
+
+	if (UsesNodeStore()) {
+		NodeStore.x[i] += positionOffset.x;
+		NodeStore.y[i] += positionOffset.y;
+		NodeStore.oldX[i] += oldPositionOffset.x;
+		NodeStore.oldY[i] += oldPositionOffset.y;
+	}
+	else {
+		AllNodes[i].Position += positionOffset;
+		AllNodes[i].OldPosition += oldPositionOffset;
+	}
+}
+
+void RopePhysicsSolver::GatherNodeStore() {
+
+	NodeStore.Resize(AllNodes.size());
+
+	// every task owns whole 64-node anchor words, so no two threads write the same word.
+	// with sticky chunks each thread gathers about the same nodes it integrates, so a freshly resized store is first touched by them
+	threadpool.ParralelFor(0, NodeStore.WordCount(), [&](int word) {
+		NodeStore.GatherWord(AllNodes, word);
+	});
+}
+
+void RopePhysicsSolver::ScatterNodeStore() {
+
+	threadpool.ParralelFor(0, NodeStore.WordCount(), [&](int word) {
+		NodeStore.ScatterWord(AllNodes, word);
+	});
+}
+
 void RopePhysicsSolver::ApplyForces(RopeNode& node) {
 
-	Accelerate(node, config.physics.g); // apply gravity for all nodes
+	Accelerate(node, config.physics.g); // apply gravity for all nodes
+}
+
+// advance the simulation by one step of deltaTime
+void RopePhysicsSolver::StepSimulation(const InteractionInput& input, const int requestedSubsteps, const int iterations, const double deltaTime) {
+
+	int substeps = config.physics.adaptiveSubsteps ? ChooseSubsteps(deltaTime) : requestedSubsteps;
+	LastSubsteps = substeps;
+
+	float subDT = deltaTime / substeps;
+
+	// changed physics settings (GUI sliders) affect every rope
+	WakeOnPhysicsChange();
+
+	Vector2 dragStartFramePos = {};
+
+	// steps without a frame in between (fixed time step) get the same input, so the press is tracked per step
+	bool dragPressed = input.dragHeld && !dragHeldLastStep;
+	dragHeldLastStep = input.dragHeld;
+
+	//rope interaction
+	// Only search for a new node if we aren't already dragging one
+	if (config.interaction.draggedRope.IsNull()) {
+		dragStartFramePos = FindNodeToMove(input, dragPressed);
+	}
+	else {
+		// If we are already dragging, just get the position from the active rope
+		if (config.interaction.draggedNodeID != -1) {
+			dragStartFramePos = AllNodes[config.interaction.draggedNodeID].Position;
+		}
+	}
+
+	bool useNodeStore = UsesNodeStore();
+
+	for (Rope& rope : AllRopes) {
+		rope.iterationsUsed = 0;
+	}
+
+	// new shapes since the last step
+	Colliders.Update();
+	bool staticCollisions = config.physics.staticCollisions && !Colliders.IsEmpty();
+
+	if (RopeGroupsOutdated()) {
+		BuildRopeGroups();
+	}
+
+	// simulate on the structure-of-arrays copy for this frame
+	if (useNodeStore) {
+		GatherNodeStore();
+	}
+
+	// collisions couple the ropes in every sub-step, so they can't be stepped on their own
+	if (config.physics.fusedRopePipeline && !config.physics.nodeCollisions) {
+		StepRopesFused(input, substeps, iterations, subDT, dragStartFramePos);
+	}
+	else {
+
+		// UpdateRope is rope's full life cycle. use after creating the ropes to update and render them
+		for (int i = 1; i <= substeps; i++) {
+
+			//update positions
+			if (useNodeStore) {
+
+				// hand out whole blocks of nodes so the kernel can work on many nodes per instruction
+				int blockCount = (NodeStore.Size() + IntegrationBlockSize - 1) / IntegrationBlockSize;
+
+				threadpool.ParralelFor(0, blockCount, [&](int block) {
+
+					int begin = block * IntegrationBlockSize;
+					int end = std::min(begin + IntegrationBlockSize, NodeStore.Size());
+					IntegrateNodeStoreRange(begin, end, subDT);
+				});
+			}
+			else {
+
+				threadpool.ParralelFor(0, AllNodes.size(), [&](int i) {
+
+					Rope& thisRope = AllRopes[AllNodes[i].RopeID];
+					if (thisRope.isSleeping) return;
+
+					ApplyForces(AllNodes[i]);
+					UpdateRopeNodePosition(AllNodes[i], thisRope, subDT);
+
+				});
+			}
+
+			//move the node
+			int movedNodeID = config.interaction.draggedNodeID;
+
+			for (Rope& rope : AllRopes) {
+				MoveRopeNode(rope, input, substeps, i, dragStartFramePos);
+			}
+
+			// MoveRopeNode works on AllNodes, so copy the dragged node into the store
+			if (useNodeStore && movedNodeID != -1) {
+				NodeStore.LoadNode(movedNodeID, AllNodes[movedNodeID]);
+			}
+
+			//calculate constraints. short ropes are handed out in groups of about the same amount of links
+			threadpool.ParralelFor(0, RopeGroupStarts.size() - 1, [&](int group) {
+
+				for (int r = RopeGroupStarts[group]; r < RopeGroupStarts[group + 1]; r++) {
+
+					Rope& thisRope = AllRopes[r];
+					if (thisRope.isSleeping || UsesColoredSolve(thisRope)) continue;
+
+					ApplyConstraints(thisRope, iterations, subDT);
+				}
+			});
+
+			// long ropes are split across all threads, one after another
+			for (Rope& rope : AllRopes) {
+
+				if (!rope.isSleeping && UsesColoredSolve(rope)) {
+					ApplyConstraintsColored(rope, iterations, subDT);
+				}
+			}
+
+			// push overlapping nodes apart, across ropes and within a rope
+			if (config.physics.nodeCollisions) {
+				SolveNodeCollisions();
+			}
+
+			// and out of the level geometry, last so nothing ends up inside it
+			if (staticCollisions) {
+
+				int blockCount = (AllNodes.size() + IntegrationBlockSize - 1) / IntegrationBlockSize;
+
+				threadpool.ParralelFor(0, blockCount, [&](int block) {
+
+					int begin = block * IntegrationBlockSize;
+					int end = std::min(begin + IntegrationBlockSize, (int)AllNodes.size());
+					CollideNodeStoreRange(begin, end);
+				});
+			}
+
+		}
+	}
+
+	// make AllNodes valid again for rendering and interaction
+	if (useNodeStore) {
+		ScatterNodeStore();
+	}
+
+	LastFrameIterations = 0;
+	for (const Rope& rope : AllRopes) {
+		LastFrameIterations += rope.iterationsUsed;
+	}
+
+	MeasureRopeMotion(subDT);
+	UpdateSleepState();
+}
+
+// run all sub-steps of every rope inside one task per rope group: integrate, move the dragged node and solve the constraints
+// without waiting for the other ropes in between. ropes don't interact, so the only barrier left is the one at the end
+void RopePhysicsSolver::StepRopesFused(const InteractionInput& input, const int substeps, const int iterations, const float subDT, const Vector2 dragStartFramePos) {
+
+	// anchor the dragged node up front. neighbouring ropes share anchor words in the store, so the tasks can't do it
+	int draggedNodeID = config.interaction.draggedNodeID;
+	if (input.dragHeld && !config.interaction.draggedRope.IsNull() && draggedNodeID != -1) {
+
+		AllNodes[draggedNodeID].IsAnchored = true;
+		if (UsesNodeStore()) NodeStore.SetAnchored(draggedNodeID, true);
+	}
+
+	// static colliders only move the nodes of one rope at a time, so they fit in here
+	bool staticCollisions = config.physics.staticCollisions && !Colliders.IsEmpty();
+
+	threadpool.ParralelFor(0, RopeGroupStarts.size() - 1, [&](int group) {
+
+		for (int r = RopeGroupStarts[group]; r < RopeGroupStarts[group + 1]; r++) {
+
+			Rope& rope = AllRopes[r];
+			if (rope.isSleeping || UsesColoredSolve(rope)) continue;
+
+			for (int i = 1; i <= substeps; i++) {
+
+				IntegrateRope(rope, rope.startNodeIndex, rope.startNodeIndex + rope.nodeAmount, subDT);
+				MoveDraggedNode(rope, input, substeps, i, dragStartFramePos);
+				ApplyConstraints(rope, iterations, subDT);
+
+				if (staticCollisions) {
+					CollideRopeNodes(rope, rope.startNodeIndex, rope.startNodeIndex + rope.nodeAmount);
+				}
+			}
+		}
+	});
+
+	// ropes long enough for the colored solver need every thread in every sub-step, so they are stepped one after another
+	for (Rope& rope : AllRopes) {
+
+		if (rope.isSleeping || !UsesColoredSolve(rope)) continue;
+
+		int blockCount = (rope.nodeAmount + IntegrationBlockSize - 1) / IntegrationBlockSize;
+
+		for (int i = 1; i <= substeps; i++) {
+
+			threadpool.ParralelFor(0, blockCount, [&](int block) {
+
+				int begin = rope.startNodeIndex + block * IntegrationBlockSize;
+				int end = std::min(begin + IntegrationBlockSize, rope.startNodeIndex + rope.nodeAmount);
+				IntegrateRope(rope, begin, end, subDT);
+			});
+
+			MoveDraggedNode(rope, input, substeps, i, dragStartFramePos);
+			ApplyConstraintsColored(rope, iterations, subDT);
+
+			if (staticCollisions) {
+
+				threadpool.ParralelFor(0, blockCount, [&](int block) {
+
+					int begin = rope.startNodeIndex + block * IntegrationBlockSize;
+					int end = std::min(begin + IntegrationBlockSize, rope.startNodeIndex + rope.nodeAmount);
+					CollideRopeNodes(rope, begin, end);
+				});
+			}
+		}
+	}
+}
+
+// integrate the nodes [begin, end) of one rope in whichever layout is active
+void RopePhysicsSolver::IntegrateRope(Rope& rope, const int begin, const int end, const float subDT) {
+
+	if (UsesNodeStore()) {
+		IntegrateNodeStoreRange(begin, end, subDT);
+		return;
+	}
+
+	for (int i = begin; i < end; i++) {
+		ApplyForces(AllNodes[i]);
+		UpdateRopeNodePosition(AllNodes[i], rope, subDT);
+	}
+}
+
+// MoveRopeNode for a single rope, keeping the store in sync. only touches the nodes of that rope, so ropes can do this in parallel
+void RopePhysicsSolver::MoveDraggedNode(Rope& rope, const InteractionInput& input, const int substeps, const int i, const Vector2 dragStartFramePos) {
+
+	MoveRopeNode(rope, input, substeps, i, dragStartFramePos);
+
+	int draggedNodeID = config.interaction.draggedNodeID;
+	if (UsesNodeStore() && config.interaction.draggedRope == rope.handle && draggedNodeID != -1) {
+		NodeStore.LoadNodePosition(draggedNodeID, AllNodes[draggedNodeID]);
+	}
+}
+
+// one Jacobi pass over all node pairs closer than their radii. every node sums up how far its contacts push it and then
+// moves by the average, so the pass runs in parallel without two threads ever writing the same node
+void RopePhysicsSolver::SolveNodeCollisions() {
+
+	int nodeCount = AllNodes.size();
+	if (nodeCount == 0) return;
+
+	float maxRadius = 0;
+	for (const Rope& rope : AllRopes) {
+		maxRadius = std::max(maxRadius, rope.Radius);
+	}
+	if (maxRadius <= 0) return;
+
+	// two nodes touch if they are closer than the sum of their radii, so that's the cell size
+	CollisionHash.Build(nodeCount, [&](int i) { return GetNodePosition(i); }, 2 * maxRadius, threadpool, config.physics.deterministic);
+
+	CollisionDeltas.resize(nodeCount);
+	CollisionCounts.resize(nodeCount);
+	CollisionNodes.resize(nodeCount);
+	RopeContacts.assign(AllRopes.size(), 0);
+
+	const std::vector<uint32_t>& sortedNodes = CollisionHash.SortedPoints();
+	const std::vector<Vector2>& sortedPositions = CollisionHash.SortedPositions();
+	int blockCount = (nodeCount + CollisionBlockSize - 1) / CollisionBlockSize;
+	bool selfCollisions = config.physics.ropeSelfCollisions;
+
+	// copy what the narrowphase needs about every node next to its sorted position, so checking a candidate doesn't
+	// have to look up its node and rope somewhere else in memory
+	threadpool.ParralelFor(0, blockCount, [&](int block) {
+
+		int end = std::min(nodeCount, (block + 1) * CollisionBlockSize);
+
+		for (int s = block * CollisionBlockSize; s < end; s++) {
+
+			int i = sortedNodes[s];
+			const Rope& rope = AllRopes[AllNodes[i].RopeID];
+
+			CollisionNode& node = CollisionNodes[s];
+			node.ropeID = AllNodes[i].RopeID;
+			node.radius = rope.Radius;
+			node.weight = IsNodeAnchored(i) ? 0.0f : 1.0f;
+			node.isSleeping = rope.isSleeping;
+		}
+	});
+
+	// narrowphase, walking the nodes in hash order so the nodes of one cell run their queries one after another
+	threadpool.ParralelFor(0, blockCount, [&](int block) {
+
+		int end = std::min(nodeCount, (block + 1) * CollisionBlockSize);
+
+		for (int s = block * CollisionBlockSize; s < end; s++) {
+
+			int i = sortedNodes[s];
+			Vector2 position = sortedPositions[s];
+			const CollisionNode& node = CollisionNodes[s];
+
+			Vector2 delta = { 0,0 };
+			int contacts = 0;
+
+			// anchored nodes don't move, but their partners still need to see them
+			if (node.weight > 0) {
+
+				// nodes this close along the same rope overlap when the rope is at rest, they never collide
+				const Rope& rope = AllRopes[node.ropeID];
+				int ignoredNeighbours = (int)ceilf(2 * rope.Radius / rope.RopeLengthForEach);
+
+				CollisionHash.ForEachSortedNear(position, node.radius + maxRadius, [&](int other) {
+
+					const CollisionNode& otherNode = CollisionNodes[other];
+					int j = sortedNodes[other];
+
+					if (otherNode.ropeID == node.ropeID && (!selfCollisions || abs(j - i) <= ignoredNeighbours)) return;
+
+					// resting ropes don't push each other around
+					if (node.isSleeping && otherNode.isSleeping) return;
+
+					Vector2 offset = position - sortedPositions[other];
+					float minDistance = node.radius + otherNode.radius;
+					float distanceSqr = Vector2LengthSqr(offset);
+
+					if (distanceSqr >= minDistance * minDistance || distanceSqr == 0) return;
+
+					float distance = sqrtf(distanceSqr);
+
+					// each node of the pair moves its share of the overlap, the other node handles its own share
+					delta += offset * ((minDistance - distance) / distance * node.weight / (node.weight + otherNode.weight));
+					contacts++;
+				});
+			}
+
+			CollisionDeltas[i] = delta;
+			CollisionCounts[i] = contacts;
+		}
+	});
+
+	// apply the averaged pushes. a pushed node of a sleeping rope wakes the rope up
+	threadpool.ParralelFor(0, blockCount, [&](int block) {
+
+		int end = std::min(nodeCount, (block + 1) * CollisionBlockSize);
+
+		for (int i = block * CollisionBlockSize; i < end; i++) {
+
+			if (CollisionCounts[i] == 0) continue;
+
+			OffsetNode(i, CollisionDeltas[i] / (float)CollisionCounts[i], Vector2{ 0,0 });
+			std::atomic_ref<uint8_t>(RopeContacts[AllNodes[i].RopeID]).store(1, std::memory_order_relaxed);
+		}
+	});
+
+	for (int r = 0; r < (int)AllRopes.size(); r++) {
+		if (RopeContacts[r] && AllRopes[r].isSleeping) WakeRope(AllRopes[r]);
+	}
+}
+
+// push the nodes [begin, end) out of the static colliders. the range is split at rope boundaries, like the integration
+void RopePhysicsSolver::CollideNodeStoreRange(int begin, int end) {
+
+	while (begin < end) {
+
+		const Rope& thisRope = AllRopes[AllNodes[begin].RopeID];
+		int ropeEnd = thisRope.startNodeIndex + thisRope.nodeAmount;
+		int segmentEnd = ropeEnd < end ? ropeEnd : end;
+
+		if (!thisRope.isSleeping) {
+			CollideRopeNodes(thisRope, begin, segmentEnd);
+		}
+
+		begin = segmentEnd;
+	}
+}
+
+// push the nodes [begin, end) of one rope out of the static colliders. nodes are handled in batches: the shapes near the
+// bounds of a batch are looked up once and every node only tests those. a batch in the middle of dense geometry
+// (more than MaxBatchedColliders shapes) asks the hierarchy per node instead, so a node never tests more than the shapes near itself
+void RopePhysicsSolver::CollideRopeNodes(const Rope& rope, int begin, int end) {
+
+	thread_local std::vector<int> nearColliders;
+
+	float radius = rope.Radius;
+	float friction = config.physics.colliderFriction;
+
+	for (int batchBegin = begin; batchBegin < end; batchBegin += ColliderBatchSize) {
+
+		int batchEnd = std::min(batchBegin + ColliderBatchSize, end);
+
+		Vector2 boundsMin = GetNodePosition(batchBegin);
+		Vector2 boundsMax = boundsMin;
+
+		for (int i = batchBegin + 1; i < batchEnd; i++) {
+			Vector2 position = GetNodePosition(i);
+			boundsMin = Vector2Min(boundsMin, position);
+			boundsMax = Vector2Max(boundsMax, position);
+		}
+
+		nearColliders.clear();
+		Colliders.QueryBounds(boundsMin - Vector2{ radius, radius }, boundsMax + Vector2{ radius, radius }, [&](int c) {
+			nearColliders.push_back(c);
+		});
+
+		if (nearColliders.empty()) continue;
+
+		bool queryPerNode = nearColliders.size() > MaxBatchedColliders;
+
+		for (int i = batchBegin; i < batchEnd; i++) {
+
+			if (IsNodeAnchored(i)) continue;
+
+			Vector2 position = GetNodePosition(i);
+			Vector2 totalPush = { 0,0 };
+
+			// resolve the shapes one after another, so a node in a corner ends up outside of both
+			auto resolve = [&](int c) {
+
+				Vector2 push;
+				if (Colliders.Resolve(c, position, radius, push)) {
+					position += push;
+					totalPush += push;
+				}
+			};
+
+			if (queryPerNode) {
+				Colliders.QueryBounds(position - Vector2{ radius, radius }, position + Vector2{ radius, radius }, resolve);
+			}
+			else {
+
+				// cheap bounds test first, most shapes near the batch aren't near this node
+				const std::vector<Collider>& colliders = Colliders.GetColliders();
+
+				for (int c : nearColliders) {
+
+					const Collider& collider = colliders[c];
+					if (position.x + radius < collider.boundsMin.x || position.x - radius > collider.boundsMax.x ||
+						position.y + radius < collider.boundsMin.y || position.y - radius > collider.boundsMax.y) continue;
+
+					resolve(c);
+				}
+			}
+
+			float pushLength = Vector2Length(totalPush);
+			if (pushLength == 0) continue;
+
+			// friction takes away part of the velocity along the surface, by moving the old position with the node
+			Vector2 normal = totalPush / pushLength;
+			Vector2 velocity = GetNodePosition(i) - GetNodeOldPosition(i);
+			Vector2 tangentVelocity = velocity - normal * Vector2DotProduct(velocity, normal);
+
+			OffsetNode(i, totalPush, tangentVelocity * friction);
+		}
+	}
+}
+
+// interaction that has to happen exactly once per rendered frame, no matter how many steps were simulated
+void RopePhysicsSolver::FinishFrameInteraction(const InteractionInput& input) {
+
+	for (Rope& rope : AllRopes) {
+		ReleaseRopeNode(rope, input);
+		//toggle if we want the node to be ahnchored
+		ToggleAnchor(rope, input);
+	}
+}
+
+void RopePhysicsSolver::UpdateRopes(const InteractionInput& input, const int substeps, const int iterations, const double deltaTime) {
+
+	StepSimulation(input, substeps, iterations, deltaTime);
+	FinishFrameInteraction(input);
+
+	if (Recorder != nullptr) {
+		Recorder->RecordFrame(AllNodes.data(), AllNodes.size(), threadpool);
+	}
+}
+
+// run as many fixed steps as the elapsed frame time allows and remember how far we are into the next one
+void RopePhysicsSolver::UpdateRopesFixed(const InteractionInput& input, const int substeps, const int iterations, const double frameTime) {
+
+	double fixedStep = config.physics.fixedTimeStep;
+	TimeAccumulator += frameTime;
+
+	int steps = 0;
+	while (TimeAccumulator >= fixedStep && steps < config.physics.maxStepsPerFrame) {
+
+		// positions before the step, the renderer blends between them and the new ones
+		PreviousPositions.resize(AllNodes.size());
+		for (size_t i = 0; i < AllNodes.size(); i++) {
+			PreviousPositions[i] = AllNodes[i].Position;
+		}
+
+		StepSimulation(input, substeps, iterations, fixedStep);
+		TimeAccumulator -= fixedStep;
+		steps++;
+
+		// one recorded frame per step, like UpdateRopes, so a trajectory doesn't depend on the frame rate it was recorded at
+		if (Recorder != nullptr) {
+			Recorder->RecordFrame(AllNodes.data(), AllNodes.size(), threadpool);
+		}
+	}
+
+	// we can't catch up (spiral of death), drop the time we are behind instead of running even more steps next frame
+	if (TimeAccumulator >= fixedStep) {
+		TimeAccumulator = fmod(TimeAccumulator, fixedStep);
+	}
+
+	InterpolationAlpha = (float)(TimeAccumulator / fixedStep);
+
+	FinishFrameInteraction(input);
+}
+
+
+void RopePhysicsSolver::WakeRope(Rope& rope) {
+
+	rope.isSleeping = false;
+	rope.calmFrames = 0;
+}
+
+void RopePhysicsSolver::WakeAllRopes() {
+
+	for (Rope& rope : AllRopes) {
+		WakeRope(rope);
+	}
+}
+
+void RopePhysicsSolver::WakeOnPhysicsChange() {
+
+	const PhysicsConfig& physics = config.physics;
+
+	bool hasChanged = physics.g.x != lastPhysics.g.x || physics.g.y != lastPhysics.g.y ||
+		physics.airDensity != lastPhysics.airDensity || physics.dragCoef != lastPhysics.dragCoef ||
+		physics.areRopesRigid != lastPhysics.areRopesRigid;
+
+	if (hasChanged) {
+		WakeAllRopes();
+	}
+
+	lastPhysics = physics;
+}
+
+// kinetic energy and fastest node of every awake rope, velocities from the last sub-step
+void RopePhysicsSolver::MeasureRopeMotion(const float subDT) {
+
+	threadpool.ParralelFor(0, AllRopes.size(), [&](int r) {
+
+		Rope& rope = AllRopes[r];
+
+		rope.kineticEnergy = 0;
+		rope.maxNodeSpeed = 0;
+		if (rope.isSleeping) return;
+
+		float energy = 0;
+		float maxSpeedSqr = 0;
+
+		for (int i = rope.startNodeIndex; i < rope.startNodeIndex + rope.nodeAmount; ++i) {
+
+			Vector2 velocity = (AllNodes[i].Position - AllNodes[i].OldPosition) / subDT;
+			float speedSqr = Vector2LengthSqr(velocity);
+
+			energy += 0.5f * speedSqr;
+			maxSpeedSqr = std::max(maxSpeedSqr, speedSqr);
+		}
+
+		// average per node (unit mass)
+		rope.kineticEnergy = energy / rope.nodeAmount;
+		rope.maxNodeSpeed = sqrtf(maxSpeedSqr);
+	});
+}
+
+// put ropes to sleep that have been calm for long enough. sleeping ropes are skipped by the integration and constraint passes
+void RopePhysicsSolver::UpdateSleepState() {
+
+	if (!config.physics.allowSleeping) {
+		WakeAllRopes();
+		return;
+	}
+
+	threadpool.ParralelFor(0, AllRopes.size(), [&](int r) {
+
+		Rope& rope = AllRopes[r];
+		if (rope.isSleeping) return;
+
+		// the dragged rope is never calm
+		if (config.interaction.draggedRope == rope.handle || rope.kineticEnergy > config.physics.sleepEnergyThreshold) {
+			rope.calmFrames = 0;
+			return;
+		}
+
+		if (++rope.calmFrames < config.physics.sleepFrames) return;
+
+		// fall asleep without any velocity left, so the rope doesn't jump when it wakes up
+		rope.isSleeping = true;
+		for (int i = rope.startNodeIndex; i < rope.startNodeIndex + rope.nodeAmount; ++i) {
+			AllNodes[i].OldPosition = AllNodes[i].Position;
+			AllNodes[i].Acceleration = { 0,0 };
+		}
+	});
+}
+
+// pick the sub-step count for the next step from how fast the ropes moved and how well their constraints were solved during the last one
+int RopePhysicsSolver::ChooseSubsteps(const double deltaTime) {
+
+	const PhysicsConfig& physics = config.physics;
+
+	// relative to the link length, so short links ask for more sub-steps
+	float maxSpeed = 0;
+	float maxResidual = 0;
+
+	for (const Rope& rope : AllRopes) {
+
+		if (rope.isSleeping) continue;
+
+		maxSpeed = std::max(maxSpeed, rope.maxNodeSpeed / rope.RopeLengthForEach);
+		maxResidual = std::max(maxResidual, rope.residualError);
+	}
+
+	// no node should travel more than maxSubstepTravel link lengths in one sub-step
+	int substeps = (int)ceil(maxSpeed * deltaTime / physics.maxSubstepTravel);
+
+	// the error left after a sub-step shrinks roughly with dt^2, so sqrt(residual / target) times more sub-steps bring it down to the target
+	if (maxResidual > physics.targetResidualError) {
+		substeps = std::max(substeps, (int)ceil(LastSubsteps * sqrtf(maxResidual / physics.targetResidualError)));
+	}
+
+	// only drop one sub-step per frame, so calm moments between fast ones don't make the count jump back and forth
+	substeps = std::max(substeps, LastSubsteps - 1);
+
+	return std::clamp(substeps, physics.minSubsteps, physics.maxSubsteps);
+}
+
+Rope& RopePhysicsSolver::SetupRope(const Vector2 firstNodePos, bool isFirstNodeAnchored, int nodeAmount, float RopeLengthForEach, float nodeRadiusForEach) {
+
+	// a straight rope to the right
+	RopeDescriptor descriptor;
+	descriptor.firstNodePos = firstNodePos;
+	descriptor.isFirstNodeAnchored = isFirstNodeAnchored;
+	descriptor.nodeAmount = nodeAmount;
+	descriptor.ropeLengthForEach = RopeLengthForEach;
+	descriptor.nodeRadius = nodeRadiusForEach;
+
+	SpawnRopes({ descriptor });
+
+	return AllRopes.back();
+}
+
+std::vector<RopeHandle> RopePhysicsSolver::SpawnRopes(const std::vector<RopeDescriptor>& descriptors) {
+
+	std::vector<RopeHandle> handles;
+	handles.reserve(descriptors.size());
+
+	int firstNewNode = AllNodes.size();
+	int firstNewRope = AllRopes.size();
+
+	int requiredNodes = firstNewNode;
+	for (const RopeDescriptor& descriptor : descriptors) {
+		requiredNodes += std::max(descriptor.nodeAmount, 1);
+	}
+
+	// grow the node buffers once for all ropes, and with headroom, so spawning rope after rope doesn't copy the nodes every time
+	if (requiredNodes > (int)AllNodes.capacity()) {
+		GrowNodeBuffers(std::max(requiredNodes, (int)(AllNodes.capacity() * NodeGrowthFactor)));
+	}
+
+	// the ropes themselves are cheap, set them up here
+	for (const RopeDescriptor& descriptor : descriptors) {
+
+		int nodeAmount = std::max(descriptor.nodeAmount, 1);
+
+		AllRopes.emplace_back(nodeAmount, descriptor.nodeRadius, descriptor.ropeLengthForEach); // Add this rope to a list of all existing ropes
+		Rope& rope = AllRopes.back();
+
+		rope.startNodeIndex = AllRopes.size() == 1 ? 0 : AllRopes[AllRopes.size() - 2].startNodeIndex + AllRopes[AllRopes.size() - 2].nodeAmount;
+
+		rope.handle = AllocateRopeHandle(AllRopes.size() - 1);
+		handles.push_back(rope.handle);
+	}
+
+	// fit the shapes, then place the nodes in parallel
+	std::vector<RopeShapeSampler> samplers;
+	samplers.reserve(descriptors.size());
+	for (const RopeDescriptor& descriptor : descriptors) {
+		samplers.emplace_back(descriptor);
+	}
+
+	AllNodes.resize(requiredNodes);
+	// one multiplier per link, stored at the index of the link's first node
+	LinkLambdas.resize(requiredNodes, 0.0f);
+
+	int newNodeCount = requiredNodes - firstNewNode;
+	int blockCount = (newNodeCount + IntegrationBlockSize - 1) / IntegrationBlockSize;
+
+	threadpool.ParralelFor(0, blockCount, [&](int block) {
+
+		int begin = firstNewNode + block * IntegrationBlockSize;
+		int end = std::min(begin + IntegrationBlockSize, requiredNodes);
+
+		// rope of the first node in this block
+		int ropeID = std::upper_bound(AllRopes.begin() + firstNewRope, AllRopes.end(), begin,
+			[](int node, const Rope& rope) { return node < rope.startNodeIndex; }) - AllRopes.begin() - 1;
+
+		for (int i = begin; i < end; i++) {
+
+			while (i >= AllRopes[ropeID].startNodeIndex + AllRopes[ropeID].nodeAmount) ropeID++;
+
+			const Rope& rope = AllRopes[ropeID];
+			const RopeDescriptor& descriptor = descriptors[ropeID - firstNewRope];
+			int n = i - rope.startNodeIndex;
+
+			bool isAnchored = (n == 0 && descriptor.isFirstNodeAnchored) || (n == rope.nodeAmount - 1 && n > 0 && descriptor.isLastNodeAnchored);
+
+			AllNodes[i] = RopeNode(samplers[ropeID - firstNewRope].NodePosition(n), Vector2{ 0,0 }, descriptor.nodeRadius, descriptor.ropeLengthForEach, isAnchored, ropeID);
+		}
+	});
+
+	ropeGroupsDirty = true;
+
+	return handles;
+}
+
+// a handle for a new rope, reusing the slot of a removed rope if there is one
+RopeHandle RopePhysicsSolver::AllocateRopeHandle(int ropeID) {
+
+	int slot;
+	if (!FreeRopeSlots.empty()) {
+		slot = FreeRopeSlots.back();
+		FreeRopeSlots.pop_back();
+	}
+	else {
+		slot = RopeSlots.size();
+		RopeSlots.push_back({ -1, 1 });
+	}
+
+	RopeSlots[slot].ropeID = ropeID;
+	return { slot, RopeSlots[slot].generation };
 }
 
-void RopePhysicsSolver::UpdateRopes(Camera2D& camera, const int substeps, const int iterations, const double deltaTime) {
+void RopePhysicsSolver::ReserveNodes(int nodeCount) {
 
-	float subDT = deltaTime / substeps;
+	reservedNodes = std::max(nodeCount, 0);
+	GrowNodeBuffers(reservedNodes);
+}
 
+void RopePhysicsSolver::GrowNodeBuffers(int nodeCount) {
 
-	Vector2 dragStartFramePos = {};
+	AllNodes.reserve(nodeCount);
+	LinkLambdas.reserve(nodeCount);
+	PreviousPositions.reserve(nodeCount);
+}
 
-	//rope interaction
-	// Only search for a new node if we aren't already dragging one
-	if (config.interaction.draggedRope == nullptr) {
-		for (Rope& rope : AllRopes) {
-			dragStartFramePos = FindNodeToMove(rope, camera);
-			// If we found a node in this rope, stop checking other ropes
-			if (config.interaction.draggedRope != nullptr) break;
+int RopePhysicsSolver::GetRopeID(const RopeHandle handle) const {
+
+	if (handle.slot < 0 || handle.slot >= (int)RopeSlots.size()) return -1;
+
+	const RopeSlot& slot = RopeSlots[handle.slot];
+	return slot.generation == handle.generation ? slot.ropeID : -1;
+}
+
+Rope* RopePhysicsSolver::GetRope(const RopeHandle handle) {
+
+	int ropeID = GetRopeID(handle);
+	return ropeID != -1 ? &AllRopes[ropeID] : nullptr;
+}
+
+void RopePhysicsSolver::RemoveRope(const RopeHandle handle) {
+
+	int ropeID = GetRopeID(handle);
+	if (ropeID != -1) RemoveRopes({ ropeID });
+}
+
+void RopePhysicsSolver::RemoveRope(int ropeID) {
+
+	RemoveRopes({ ropeID });
+}
+
+void RopePhysicsSolver::RemoveRopes(const std::vector<int>& ropeIDs) {
+
+	int ropeCount = AllRopes.size();
+	int nodeCount = AllNodes.size();
+
+	// new ID of every rope, -1 for removed ones
+	std::vector<int> newRopeIDs(ropeCount, 0);
+	bool anyRemoved = false;
+
+	for (int ropeID : ropeIDs) {
+
+		if (ropeID < 0 || ropeID >= ropeCount) continue;
+		newRopeIDs[ropeID] = -1;
+		anyRemoved = true;
+	}
+	if (!anyRemoved) return;
+
+	// let go of a dragged node that is about to disappear
+	int draggedRopeID = GetRopeID(config.interaction.draggedRope);
+	if (draggedRopeID != -1 && newRopeIDs[draggedRopeID] == -1) {
+		config.interaction.draggedRope = RopeHandle{};
+		config.interaction.draggedNodeID = -1;
+		draggedRopeID = -1;
+	}
+
+	// interpolation data is only kept if it belongs to these nodes
+	bool keepPreviousPositions = (int)PreviousPositions.size() == nodeCount;
+
+	// slide the nodes of the kept ropes down over the gaps, rope by rope. ropes are stored in node order, so a rope
+	// never moves onto nodes that haven't been moved yet
+	int writeRope = 0;
+	int writeNode = 0;
+
+	for (int r = 0; r < ropeCount; r++) {
+
+		Rope& rope = AllRopes[r];
+		RopeSlot& slot = RopeSlots[rope.handle.slot];
+
+		// handles of removed ropes go stale, their slots are reused by new ropes
+		if (newRopeIDs[r] == -1) {
+			slot.ropeID = -1;
+			slot.generation++;
+			FreeRopeSlots.push_back(rope.handle.slot);
+			continue;
+		}
+
+		slot.ropeID = writeRope;
+		int readNode = rope.startNodeIndex;
+
+		if (r == draggedRopeID && config.interaction.draggedNodeID != -1) {
+			config.interaction.draggedNodeID += writeNode - readNode;
+		}
+
+		if (readNode != writeNode) {
+
+			std::move(AllNodes.begin() + readNode, AllNodes.begin() + readNode + rope.nodeAmount, AllNodes.begin() + writeNode);
+			std::move(LinkLambdas.begin() + readNode, LinkLambdas.begin() + readNode + rope.nodeAmount, LinkLambdas.begin() + writeNode);
+
+			if (keepPreviousPositions) {
+				std::move(PreviousPositions.begin() + readNode, PreviousPositions.begin() + readNode + rope.nodeAmount, PreviousPositions.begin() + writeNode);
+			}
+		}
+
+		if (writeRope != r) {
+			for (int i = writeNode; i < writeNode + rope.nodeAmount; i++) {
+				AllNodes[i].RopeID = writeRope;
+			}
 		}
+
+		newRopeIDs[r] = writeRope;
+		rope.startNodeIndex = writeNode;
+		writeNode += rope.nodeAmount;
+
+		if (writeRope != r) AllRopes[writeRope] = std::move(rope);
+		writeRope++;
+	}
+
+	AllRopes.erase(AllRopes.begin() + writeRope, AllRopes.end());
+	AllNodes.erase(AllNodes.begin() + writeNode, AllNodes.end());
+	LinkLambdas.resize(writeNode);
+	PreviousPositions.resize(keepPreviousPositions ? writeNode : 0);
+
+	// give memory back once most of it is unused, but not on every removal, and not what was reserved
+	if (AllNodes.size() < AllNodes.capacity() / 4 && (int)AllNodes.capacity() > reservedNodes) {
+		AllNodes.shrink_to_fit();
+		LinkLambdas.shrink_to_fit();
+		PreviousPositions.shrink_to_fit();
+		GrowNodeBuffers(reservedNodes);
+		NodeStore = RopeNodeStore();
+
+		// per node scratch of the collision pass, sized again by the next pass
+		CollisionNodes.clear();
+		CollisionNodes.shrink_to_fit();
+		CollisionDeltas.clear();
+		CollisionDeltas.shrink_to_fit();
+		CollisionCounts.clear();
+		CollisionCounts.shrink_to_fit();
+	}
+
+	ropeGroupsDirty = true;
+}
+
+// nodes and colliders are written and read back as raw bytes
+static_assert(std::is_trivially_copyable_v<RopeNode>);
+static_assert(std::is_trivially_copyable_v<Collider>);
+
+namespace {
+
+	uint64_t AlignSnapshotOffset(uint64_t offset) {
+
+		return (offset + SnapshotAlignment - 1) / SnapshotAlignment * SnapshotAlignment;
+	}
+
+	// does the section [offset, offset + count * elementSize) fit into the file
+	bool SnapshotSectionFits(uint64_t offset, uint64_t count, uint64_t elementSize, uint64_t fileSize) {
+
+		return offset <= fileSize && count <= (fileSize - offset) / elementSize;
+	}
+}
+
+bool RopePhysicsSolver::SaveSnapshot(const char* path) const {
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file) return false;
+
+	return SaveSnapshot(file);
+}
+
+bool RopePhysicsSolver::SaveSnapshot(std::ostream& file) const {
+
+	SnapshotHeader header = {};
+	std::copy(std::begin(SnapshotMagic), std::end(SnapshotMagic), header.magic);
+	header.version = SnapshotVersion;
+	header.byteOrderMark = SnapshotByteOrderMark;
+	header.ropeSize = sizeof(SnapshotRope);
+	header.nodeSize = sizeof(RopeNode);
+	header.colliderSize = sizeof(Collider);
+	header.ropeCount = AllRopes.size();
+	header.nodeCount = AllNodes.size();
+	header.colliderCount = Colliders.GetColliders().size();
+
+	header.ropeOffset = AlignSnapshotOffset(sizeof(SnapshotHeader));
+	header.nodeOffset = AlignSnapshotOffset(header.ropeOffset + header.ropeCount * sizeof(SnapshotRope));
+	header.lambdaOffset = AlignSnapshotOffset(header.nodeOffset + header.nodeCount * sizeof(RopeNode));
+	header.colliderOffset = AlignSnapshotOffset(header.lambdaOffset + header.nodeCount * sizeof(float));
+	header.fileSize = header.colliderOffset + header.colliderCount * sizeof(Collider);
+
+	std::vector<SnapshotRope> ropes(AllRopes.size());
+	for (size_t r = 0; r < AllRopes.size(); r++) {
+
+		const Rope& rope = AllRopes[r];
+		ropes[r] = { rope.startNodeIndex, rope.nodeAmount, rope.Radius, rope.RopeLengthForEach,
+			(uint32_t)rope.solver, rope.compliance, (uint32_t)rope.isSleeping, rope.calmFrames };
+	}
+
+	// write a section at its offset, padding the gap before it with zeros
+	uint64_t written = 0;
+	auto writeSection = [&](uint64_t offset, const void* data, uint64_t bytes) {
+
+		static const char padding[SnapshotAlignment] = {};
+		file.write(padding, offset - written);
+		file.write(static_cast<const char*>(data), bytes);
+		written = offset + bytes;
+	};
+
+	writeSection(0, &header, sizeof(header));
+	writeSection(header.ropeOffset, ropes.data(), ropes.size() * sizeof(SnapshotRope));
+	// the drag holds its node anchored. store the state the node goes back to once it is let go, a loaded scene has nothing dragged
+	int draggedNodeID = config.interaction.draggedNodeID;
+
+	if (!config.interaction.draggedRope.IsNull() && draggedNodeID >= 0 && draggedNodeID < (int)AllNodes.size()) {
+
+		RopeNode draggedNode = AllNodes[draggedNodeID];
+		draggedNode.IsAnchored = config.interaction.wasAnchored;
+
+		writeSection(header.nodeOffset, AllNodes.data(), draggedNodeID * sizeof(RopeNode));
+		writeSection(header.nodeOffset + draggedNodeID * sizeof(RopeNode), &draggedNode, sizeof(RopeNode));
+		writeSection(header.nodeOffset + (draggedNodeID + 1) * sizeof(RopeNode), AllNodes.data() + draggedNodeID + 1,
+			(AllNodes.size() - draggedNodeID - 1) * sizeof(RopeNode));
 	}
 	else {
-		// If we are already dragging, just get the position from the active rope
-		if (config.interaction.draggedNodeID != -1) {
-			dragStartFramePos = AllNodes[config.interaction.draggedNodeID].Position;
-		}
+		writeSection(header.nodeOffset, AllNodes.data(), AllNodes.size() * sizeof(RopeNode));
 	}
+	writeSection(header.lambdaOffset, LinkLambdas.data(), AllNodes.size() * sizeof(float));
+	writeSection(header.colliderOffset, Colliders.GetColliders().data(), header.colliderCount * sizeof(Collider));
 
-	// UpdateRope is rope's full life cycle. use after creating the ropes to update and render them
-	for (int i = 1; i <= substeps; i++) {
+	return file.good();
+}
 
-		//update positions
-		threadpool.ParralelFor(0, AllNodes.size(), [&](int i) {
+bool RopePhysicsSolver::LoadSnapshot(const char* path) {
 
-			Rope& thisRope = AllRopes[AllNodes[i].RopeID];
+	MappedFile file;
+	if (!file.Open(path)) return false;
 
-			ApplyForces(AllNodes[i]);
-			UpdateRopeNodePosition(AllNodes[i], thisRope, subDT);
+	return LoadSnapshot(file.Data(), file.Size());
+}
 
-		});
+bool RopePhysicsSolver::LoadSnapshot(const uint8_t* data, size_t size) {
+
+	if (size < sizeof(SnapshotHeader)) return false;
+
+	SnapshotHeader header;
+	std::memcpy(&header, data, sizeof(header));
+
+	// only files written by this build (same version, byte order and struct layouts) can be copied in as they are
+	if (!std::equal(std::begin(SnapshotMagic), std::end(SnapshotMagic), header.magic) || header.version != SnapshotVersion ||
+		header.byteOrderMark != SnapshotByteOrderMark || header.ropeSize != sizeof(SnapshotRope) ||
+		header.nodeSize != sizeof(RopeNode) || header.colliderSize != sizeof(Collider) || header.fileSize != size) {
+		return false;
+	}
+
+	if (!SnapshotSectionFits(header.ropeOffset, header.ropeCount, sizeof(SnapshotRope), header.fileSize) ||
+		!SnapshotSectionFits(header.nodeOffset, header.nodeCount, sizeof(RopeNode), header.fileSize) ||
+		!SnapshotSectionFits(header.lambdaOffset, header.nodeCount, sizeof(float), header.fileSize) ||
+		!SnapshotSectionFits(header.colliderOffset, header.colliderCount, sizeof(Collider), header.fileSize) ||
+		header.nodeCount > (uint64_t)std::numeric_limits<int>::max()) {
+		return false;
+	}
+
+	std::vector<SnapshotRope> ropes(header.ropeCount);
+	std::memcpy(ropes.data(), data + header.ropeOffset, ropes.size() * sizeof(SnapshotRope));
+
+	// the ropes have to cover the nodes back to back, like SpawnRopes lays them out
+	int64_t nextNode = 0;
+	for (const SnapshotRope& rope : ropes) {
+
+		if (rope.startNodeIndex != nextNode || rope.nodeAmount < 1 || rope.solver > (uint32_t)ConstraintSolver::XPBD) return false;
+		nextNode += rope.nodeAmount;
+	}
+	if (nextNode != (int64_t)header.nodeCount) return false;
+
+	// the node arrays are copied out of the mapping in parallel blocks, so the page reads overlap. each node has to belong to the rope
+	// whose range it is in, and its anchor flag is read as a byte: a bool that is neither 0 nor 1 is undefined once it is used
+	int nodeCount = header.nodeCount;
+	// with the reserved room, so ropes spawned after loading don't move the loaded nodes either
+	NodeArray<RopeNode> loadedNodes;
+	std::vector<float> loadedLambdas;
+	loadedNodes.reserve(std::max(nodeCount, reservedNodes));
+	loadedLambdas.reserve(std::max(nodeCount, reservedNodes));
+	loadedNodes.resize(nodeCount);
+	loadedLambdas.resize(nodeCount);
+
+	const RopeNode* nodes = reinterpret_cast<const RopeNode*>(data + header.nodeOffset);
+	const float* lambdas = reinterpret_cast<const float*>(data + header.lambdaOffset);
+	int blockCount = (nodeCount + SnapshotBlockSize - 1) / SnapshotBlockSize;
+	std::vector<uint8_t> blockIsValid(blockCount);
 
-		//move the node
-		for (Rope& rope : AllRopes) {
-			MoveRopeNode(rope, camera, substeps, i, dragStartFramePos);
+	threadpool.ParralelFor(0, blockCount, [&](int block) {
+
+		int begin = block * SnapshotBlockSize;
+		int count = std::min(SnapshotBlockSize, nodeCount - begin);
+
+		std::memcpy(loadedNodes.data() + begin, nodes + begin, count * sizeof(RopeNode));
+		std::memcpy(loadedLambdas.data() + begin, lambdas + begin, count * sizeof(float));
+
+		// the rope the block starts in, the ropes were checked to cover the nodes back to back
+		int ropeID = (int)(std::upper_bound(ropes.begin(), ropes.end(), begin,
+			[](int node, const SnapshotRope& rope) { return node < rope.startNodeIndex; }) - ropes.begin()) - 1;
+		bool valid = true;
+
+		for (int i = begin; i < begin + count; i++) {
+
+			while (i >= ropes[ropeID].startNodeIndex + ropes[ropeID].nodeAmount) ropeID++;
+
+			uint8_t isAnchored;
+			std::memcpy(&isAnchored, reinterpret_cast<const uint8_t*>(nodes + i) + offsetof(RopeNode, IsAnchored), sizeof(isAnchored));
+			loadedNodes[i].IsAnchored = isAnchored != 0;
+
+			if (loadedNodes[i].RopeID != ropeID) valid = false;
 		}
 
-		//calculate constraints
-		threadpool.ParralelFor(0, AllRopes.size(), [&](int i) {
+		blockIsValid[block] = valid;
+	});
 
-				Rope& thisRope = AllRopes[i];
-				ApplyConstraints(AllNodes, thisRope, iterations);
-			
-		});
+	if (std::find(blockIsValid.begin(), blockIsValid.end(), 0) != blockIsValid.end()) return false;
 
+	const Collider* colliders = reinterpret_cast<const Collider*>(data + header.colliderOffset);
+	for (uint64_t c = 0; c < header.colliderCount; c++) {
+
+		ColliderShape shape;
+		std::memcpy(&shape, reinterpret_cast<const uint8_t*>(colliders + c) + offsetof(Collider, shape), sizeof(shape));
+		if (shape != ColliderShape::Segment && shape != ColliderShape::Box && shape != ColliderShape::Circle) return false;
 	}
-	//toggle if we want the node to be ahnchored
-	for (Rope& rope : AllRopes) {
-		ToggleAnchor(rope);
+
+	// the file is good, replace the scene. removing the old ropes makes their handles stale and lets go of a dragged node
+	std::vector<int> oldRopes(AllRopes.size());
+	for (int r = 0; r < (int)oldRopes.size(); r++) oldRopes[r] = r;
+	RemoveRopes(oldRopes);
+
+	for (const SnapshotRope& snapshotRope : ropes) {
+
+		Rope& rope = AllRopes.emplace_back(snapshotRope.nodeAmount, snapshotRope.radius, snapshotRope.ropeLengthForEach);
+		rope.startNodeIndex = snapshotRope.startNodeIndex;
+		rope.solver = (ConstraintSolver)snapshotRope.solver;
+		rope.compliance = snapshotRope.compliance;
+		rope.isSleeping = snapshotRope.isSleeping != 0;
+		rope.calmFrames = snapshotRope.calmFrames;
+		rope.handle = AllocateRopeHandle(AllRopes.size() - 1);
+	}
+
+	AllNodes = std::move(loadedNodes);
+	LinkLambdas = std::move(loadedLambdas);
+
+	Colliders.Clear();
+	for (uint64_t c = 0; c < header.colliderCount; c++) {
+		Colliders.Add(colliders[c]);
 	}
+
+	// nothing to interpolate from or measured yet. the loaded scene starts with the current physics settings, it doesn't wake up from them
+	PreviousPositions.clear();
+	TimeAccumulator = 0;
+	InterpolationAlpha = 1;
+	LastSubsteps = 1;
+	lastPhysics = config.physics;
+	ropeGroupsDirty = true;
+	// a replay starts with the button up, so a button held while the scene is loaded counts as pressed again
+	dragHeldLastStep = false;
+
+	return true;
 }
 
+// relax the distance constraint between node i and i + 1. returns the error the link had before the correction
+float RopePhysicsSolver::SolveLink(const int i, const Rope& rope) {
 
-Rope& RopePhysicsSolver::SetupRope(const Vector2 firstNodePos, bool isFirstNodeAnchored, int nodeAmount, float RopeLengthForEach, float nodeRadiusForEach) {
+	//get the nodes
+	Vector2 positionA = GetNodePosition(i);
+	Vector2 positionB = GetNodePosition(i + 1);
+	bool isAnchoredA = IsNodeAnchored(i);
+	bool isAnchoredB = IsNodeAnchored(i + 1);
+
+	Vector2 vec = positionB - positionA;  // Vector from A to B
+	float currentDist = Vector2Length(vec);
+	float targetDist = rope.RopeLengthForEach;
+
+
+	// Only correct if distance is greater than target (rope is too long)
+	if (config.physics.areRopesRigid || (currentDist > targetDist)) [[likely]] {
+
+		// prevent division by zero
+		if (currentDist == 0) { currentDist = 0.001f; }
+
+		Vector2 dir = vec / currentDist;  // Normalized direction from A to B
+		float error = currentDist - targetDist;
+		Vector2 correction = dir * (error * 0.5f);
+
+		// prevent acces momentum build up
+		float correctionCoef = Clamp(targetDist / currentDist, 0, 0.25f);
 
-	// create a helper rope
-	AllRopes.emplace_back(nodeAmount, nodeRadiusForEach, RopeLengthForEach); // Add this rope to a list of all existing ropes
 
-	int currentRopeID = AllRopes.size() - 1;
-	// create the first node
-	AllNodes.emplace_back(firstNodePos, Vector2{ 0,0 }, nodeRadiusForEach, RopeLengthForEach, isFirstNodeAnchored, currentRopeID);
+		if (!isAnchoredA && !isAnchoredB) [[likely]] {
+			// Case 1: Neither anchored - move both toward each other
+			// (prevent access momentum build up by moving the old positions too)
+			OffsetNode(i, correction, correction * correctionCoef);
+			OffsetNode(i + 1, -correction, -correction * correctionCoef);
 
-	// set the starting index for thr newly created rope
-	AllRopes.back().startNodeIndex = AllNodes.size() - 1;
 
-	// create the rest and offset them by ropelength to the right
-	for (int i = 1; i < nodeAmount; i++) {
+		}
+		else if (isAnchoredA && !isAnchoredB) {
+			// Case 2: A anchored - move B the full error distance toward A
+			OffsetNode(i + 1, -dir * error, -dir * error * correctionCoef);
+		}
+		else if (!isAnchoredA && isAnchoredB) {
+			// Case 3: B anchored - move A the full error distance toward B
+			OffsetNode(i, dir * error, dir * error * correctionCoef);
+		}
 
-		Vector2 offset = Vector2{ RopeLengthForEach * i, 0 };
-		AllNodes.emplace_back(firstNodePos + offset, Vector2{ 0,0 }, nodeRadiusForEach, RopeLengthForEach, false, currentRopeID);
+		return fabsf(error);
 	}
 
-	return AllRopes.back();
+	return 0;
+}
+
+// XPBD version of SolveLink. the link is a spring with the rope's compliance (inverse stiffness),
+// alphaTilde = compliance / dt^2 and the accumulated multiplier of the link is kept in LinkLambdas
+float RopePhysicsSolver::SolveLinkXPBD(const int i, const Rope& rope, const float alphaTilde) {
+
+	Vector2 vec = GetNodePosition(i + 1) - GetNodePosition(i);  // Vector from A to B
+	float currentDist = Vector2Length(vec);
+	float error = currentDist - rope.RopeLengthForEach;
+
+	// Only correct if distance is greater than target (rope is too long)
+	if (!config.physics.areRopesRigid && error <= 0) return 0;
+
+	float inverseMassA = IsNodeAnchored(i) ? 0.0f : 1.0f;
+	float inverseMassB = IsNodeAnchored(i + 1) ? 0.0f : 1.0f;
+	float denominator = inverseMassA + inverseMassB + alphaTilde;
+
+	if (denominator == 0) return 0;
+
+	// prevent division by zero
+	if (currentDist == 0) { currentDist = 0.001f; }
+
+	Vector2 dir = vec / currentDist;  // Normalized direction from A to B
+
+	float& lambda = LinkLambdas[i];
+
+	// a compliant link is solved once C + alphaTilde * lambda is zero, so that's its error
+	float residual = error + alphaTilde * lambda;
+	float deltaLambda = -residual / denominator;
+	lambda += deltaLambda;
+
+	// no momentum hack needed, the compliance already makes the stiffness independent of sub-steps and iterations
+	OffsetNode(i, dir * (-inverseMassA * deltaLambda), Vector2{ 0,0 });
+	OffsetNode(i + 1, dir * (inverseMassB * deltaLambda), Vector2{ 0,0 });
+
+	return fabsf(residual);
+}
+
+float RopePhysicsSolver::SolveRopeLink(const int i, const Rope& rope, const float alphaTilde) {
+
+	if (rope.solver == ConstraintSolver::XPBD) {
+		return SolveLinkXPBD(i, rope, alphaTilde);
+	}
+	return SolveLink(i, rope);
+}
+
+// true if the largest link error of an iteration is small enough to stop iterating
+bool RopePhysicsSolver::HasConverged(const Rope& rope, const float maxError) const {
+
+	return maxError <= config.physics.constraintTolerance * rope.RopeLengthForEach;
+}
+
+// compliance scaled by the sub-step. also resets the multipliers of XPBD ropes, they start at zero every sub-step
+float RopePhysicsSolver::BeginRopeSubstep(const Rope& rope, const double deltaTime) {
+
+	if (rope.solver != ConstraintSolver::XPBD) return 0;
+
+	std::fill(LinkLambdas.begin() + rope.startNodeIndex, LinkLambdas.begin() + rope.startNodeIndex + rope.nodeAmount, 0.0f);
+
+	return rope.compliance / (float)(deltaTime * deltaTime);
 }
 
+void RopePhysicsSolver::ApplyConstraints(Rope& rope, const int iterations, const double deltaTime) {
 
-void RopePhysicsSolver::ApplyConstraints(std::vector<RopeNode>& nodes, Rope& rope, const int iterations) {
+	if (rope.solver == ConstraintSolver::Direct) {
+		rope.iterationsUsed += ApplyConstraintsDirect(rope);
+		return;
+	}
+
+	float alphaTilde = BeginRopeSubstep(rope, deltaTime);
 
 	for (int j = 0; j < iterations; ++j) {
 
+		float maxError = 0;
+
 		for (int i = rope.startNodeIndex; i < rope.startNodeIndex + rope.nodeAmount - 1; ++i) {
 
-			//get the nodes
-			RopeNode& nodeA = nodes[i];
-			RopeNode& nodeB = nodes[i + 1];
+			maxError = std::max(maxError, SolveRopeLink(i, rope, alphaTilde));
+		}
 
-			Vector2 vec = nodeB.Position - nodeA.Position;  // Vector from A to B
-			float currentDist = Vector2Length(vec);
-			float targetDist = rope.RopeLengthForEach;
+		rope.iterationsUsed++;
+		rope.residualError = maxError / rope.RopeLengthForEach;
 
+		// the rope was already solved before this iteration, the rest would change nothing
+		if (HasConverged(rope, maxError)) break;
+	}
+}
 
-			// Only correct if distance is greater than target (rope is too long)
-			if (config.physics.areRopesRigid || (currentDist > targetDist)) [[likely]] {
+// red/black Gauss-Seidel for a single long rope.
+// even links never share a node with each other (same for odd links), so every link of one color can be solved in parallel
+void RopePhysicsSolver::ApplyConstraintsColored(Rope& rope, const int iterations, const double deltaTime) {
 
-				// prevent division by zero
-				if (currentDist == 0) { currentDist = 0.001f; }
+	int linkCount = rope.nodeAmount - 1;
+	float alphaTilde = BeginRopeSubstep(rope, deltaTime);
 
-				Vector2 dir = vec / currentDist;  // Normalized direction from A to B
-				float error = currentDist - targetDist;
-				Vector2 correction = dir * (error * 0.5f);
+	for (int j = 0; j < iterations; ++j) {
 
-				// prevent acces momentum build up
-				float correctionCoef = Clamp(targetDist / currentDist, 0, 0.25f);
+		float maxError = 0;
 
+		for (int color = 0; color < 2; ++color) {
 
-				if (!nodeA.IsAnchored && !nodeB.IsAnchored) [[likely]] {
-					// Case 1: Neither anchored - move both toward each other
-					nodeA.Position += correction;
-					nodeB.Position -= correction;
+			// links of this color: startNodeIndex + color, + 2, + 4 ...
+			int colorLinkCount = (linkCount - color + 1) / 2;
+			int blockCount = (colorLinkCount + ColoredLinkBlockSize - 1) / ColoredLinkBlockSize;
 
-					// prevent access momentum build up
-					nodeA.OldPosition += correction * correctionCoef;
-					nodeB.OldPosition -= correction * correctionCoef;
+			// every block writes its own largest error, they are combined after the pass
+			ColoredBlockErrors.assign(blockCount, 0.0f);
 
+			threadpool.ParralelFor(0, blockCount, [&](int block) {
 
-				}
-				else if (nodeA.IsAnchored && !nodeB.IsAnchored) {
-					// Case 2: A anchored - move B the full error distance toward A
-					nodeB.Position -= dir * error;
+				int first = block * ColoredLinkBlockSize;
+				int last = std::min(first + ColoredLinkBlockSize, colorLinkCount);
+				float blockError = 0;
 
-					nodeB.OldPosition -= dir * error * correctionCoef;
-				}
-				else if (!nodeA.IsAnchored && nodeB.IsAnchored) {
-					// Case 3: B anchored - move A the full error distance toward B
-					nodeA.Position += dir * error;
+				for (int k = first; k < last; ++k) {
 
-					nodeA.OldPosition += dir * error * correctionCoef;
+					blockError = std::max(blockError, SolveRopeLink(rope.startNodeIndex + color + 2 * k, rope, alphaTilde));
 				}
 
+				ColoredBlockErrors[block] = blockError;
+			});
 
+			for (float blockError : ColoredBlockErrors) {
+				maxError = std::max(maxError, blockError);
 			}
 		}
+
+		rope.iterationsUsed++;
+		rope.residualError = maxError / rope.RopeLengthForEach;
+
+		if (HasConverged(rope, maxError)) break;
+	}
+}
+
+// split AllRopes into contiguous groups of about the same amount of links for the per-rope constraint pass.
+// a long rope ends up in a group of its own, hundreds of short ones share one
+void RopePhysicsSolver::BuildRopeGroups() {
+
+	// links of a rope, +1 for the per-rope overhead. ropes solved by the colored solver cost nothing in the per-rope pass
+	RopeGroupsColored.resize(AllRopes.size());
+	for (int r = 0; r < (int)AllRopes.size(); r++) {
+		RopeGroupsColored[r] = UsesColoredSolve(AllRopes[r]);
+	}
+
+	auto ropeCost = [&](int r) {
+		return RopeGroupsColored[r] ? 0 : AllRopes[r].nodeAmount + 1;
+	};
+
+	long long totalCost = 0;
+	for (int r = 0; r < (int)AllRopes.size(); r++) {
+		totalCost += ropeCost(r);
+	}
+
+	// a few groups per thread, so stealing can still even out what the link count doesn't capture (sleeping ropes, solver modes)
+	long long groupCount = std::max(1, (threadpool.ThreadCount + 1) * RopeGroupsPerThread);
+
+	RopeGroupStarts.clear();
+	RopeGroupStarts.push_back(0);
+
+	long long accumulatedCost = 0;
+	long long groupEnd = totalCost / groupCount;
+
+	for (int r = 0; r < (int)AllRopes.size(); r++) {
+
+		accumulatedCost += ropeCost(r);
+
+		// close the group once it reaches its share. the share is taken from what is left,
+		// so a long rope that overshoots its share doesn't leave a trail of tiny groups behind it
+		if (accumulatedCost >= groupEnd && r + 1 < (int)AllRopes.size()) {
+
+			RopeGroupStarts.push_back(r + 1);
+
+			long long groupsLeft = std::max<long long>(1, groupCount - (long long)RopeGroupStarts.size() + 1);
+			groupEnd = accumulatedCost + (totalCost - accumulatedCost) / groupsLeft;
+		}
 	}
+
+	RopeGroupStarts.push_back(AllRopes.size());
+
+	ropeGroupsDirty = false;
 }
 
-//calculates physics and renders all the ropes in one command
-void RopePhysicsSolver::HandleRopes(Camera2D& camera, const int substeps, const int iterations, const double deltaTime) {
+// rope.solver is set directly, so instead of being told about changes this compares every rope with what the groups were built for
+bool RopePhysicsSolver::RopeGroupsOutdated() const {
 
-		// Update physics
-		UpdateRopes(camera, substeps, iterations, deltaTime);
+	if (ropeGroupsDirty || RopeGroupsColored.size() != AllRopes.size()) return true;
+
+	for (int r = 0; r < (int)AllRopes.size(); r++) {
+		if (RopeGroupsColored[r] != (uint8_t)UsesColoredSolve(AllRopes[r])) return true;
+	}
+
+	return false;
+}
+
+bool RopePhysicsSolver::UsesColoredSolve(const Rope& rope) const {
+
+	return rope.solver != ConstraintSolver::Direct && config.physics.coloredSolveMinNodes > 0 && rope.nodeAmount >= config.physics.coloredSolveMinNodes;
+}
+
+// per-link data of the tridiagonal system
+struct DirectSolveLink
+{
+	Vector2 dir;		// normalized direction from node i to node i + 1
+
+	// long chains make the system badly conditioned, so it is solved in double precision
+	double sub;			// coupling to the previous link
+	double diag;
+	double super;		// coupling to the next link
+	double rhs;
+	double lambda;
+};
 
-		//render all ropes
-		for (int i = 0; i < AllRopes.size(); i++) {
+// solve all links of a chain at once.
+// linearizing C_k = |x(k+1) - x(k)| - length around the current positions gives a tridiagonal system (J W J^T) lambda = -C,
+// because every link only shares a node with its two neighbours. anchored nodes have an inverse mass w of 0, which is the boundary condition
+// returns the amount of sweeps that were needed
+int RopePhysicsSolver::ApplyConstraintsDirect(Rope& rope) {
 
-			Rope& thisRope = AllRopes[i];
-			RopeRenderer::RenderRopes(camera, thisRope, AllNodes);
+	int linkCount = rope.nodeAmount - 1;
+	if (linkCount < 1) return 0;
+
+	// every thread solves its own ropes, so it can keep its own scratch buffer
+	thread_local std::vector<DirectSolveLink> links;
+	links.resize(linkCount);
+
+	float targetDist = rope.RopeLengthForEach;
+
+	int sweep = 0;
+
+	for (; sweep < config.physics.directSolveSweeps; ++sweep) {
+
+		// largest error of a link that has to be fixed
+		float maxError = 0;
+
+		// build the system
+		for (int k = 0; k < linkCount; ++k) {
+
+			int i = rope.startNodeIndex + k;
+			DirectSolveLink& link = links[k];
+
+			Vector2 vec = GetNodePosition(i + 1) - GetNodePosition(i);
+			float currentDist = Vector2Length(vec);
+
+			// prevent division by zero
+			if (currentDist == 0) { currentDist = 0.001f; }
+
+			link.dir = vec / currentDist;
+
+			float inverseMassA = IsNodeAnchored(i) ? 0.0f : 1.0f;
+			float inverseMassB = IsNodeAnchored(i + 1) ? 0.0f : 1.0f;
+			float error = currentDist - targetDist;
+
+			// slack links only count if ropes are rigid. links that are just taut are kept in the system too,
+			// otherwise a stretched link can only pull its neighbour and the error creeps along the chain one link per sub-step
+			bool isActive = (config.physics.areRopesRigid || error > -DirectSolveSlack * targetDist) && inverseMassA + inverseMassB > 0;
+
+			if (isActive) {
+
+				maxError = std::max(maxError, config.physics.areRopesRigid ? fabsf(error) : error);
+
+				link.diag = inverseMassA + inverseMassB;
+				// the coupling terms only need the direction of the neighbour, which is filled in below
+				link.sub = -inverseMassA;
+				link.super = -inverseMassB;
+				link.rhs = -error;
+			}
+			else {
+				// lambda = 0, the link does nothing
+				link.diag = 1;
+				link.sub = 0;
+				link.super = 0;
+				link.rhs = 0;
+			}
+		}
+
+		rope.residualError = maxError / targetDist;
+
+		// the chain is already solved. this is the usual case after the first sweep, unless slack links got pulled tight by it
+		if (maxError <= DirectSolveTolerance * targetDist) break;
+
+		for (int k = 0; k < linkCount; ++k) {
+
+			if (k > 0) links[k].sub *= Vector2DotProduct(links[k - 1].dir, links[k].dir);
+			else links[k].sub = 0;
+
+			if (k < linkCount - 1) links[k].super *= Vector2DotProduct(links[k].dir, links[k + 1].dir);
+			else links[k].super = 0;
+		}
+
+		// Thomas algorithm: forward elimination (super and rhs are overwritten with the modified coefficients)
+		for (int k = 0; k < linkCount; ++k) {
+
+			DirectSolveLink& link = links[k];
+
+			double pivot = link.diag;
+			if (k > 0) pivot -= link.sub * links[k - 1].super;
+
+			// a singular row can only come from a fully anchored part of the chain, skip it
+			if (fabs(pivot) < 1e-9) {
+				link.super = 0;
+				link.rhs = 0;
+				continue;
+			}
+
+			double previousRhs = k > 0 ? links[k - 1].rhs : 0.0;
+
+			link.super = link.super / pivot;
+			link.rhs = (link.rhs - link.sub * previousRhs) / pivot;
+		}
+
+		// back substitution
+		links[linkCount - 1].lambda = links[linkCount - 1].rhs;
+
+		for (int k = linkCount - 2; k >= 0; --k) {
+
+			links[k].lambda = links[k].rhs - links[k].super * links[k + 1].lambda;
+		}
+
+		// move every free node by w * (lambda(k-1) * dir(k-1) - lambda(k) * dir(k))
+		for (int k = 0; k <= linkCount; ++k) {
+
+			int i = rope.startNodeIndex + k;
+			if (IsNodeAnchored(i)) continue;
+
+			Vector2 offset = { 0,0 };
+			if (k > 0) offset += links[k - 1].dir * (float)links[k - 1].lambda;
+			if (k < linkCount) offset -= links[k].dir * (float)links[k].lambda;
+
+			OffsetNode(i, offset, Vector2{ 0,0 });
+		}
+	}
+
+	return sweep;
+}
+
+//calculates physics for all the ropes in one command
+void RopePhysicsSolver::HandleRopes(const InteractionInput& input, const int substeps, const int iterations, const double deltaTime) {
+
+		// Update physics
+		if (config.physics.useFixedTimestep) {
+			UpdateRopesFixed(input, substeps, iterations, deltaTime);
+		}
+		else {
+			UpdateRopes(input, substeps, iterations, deltaTime);
+			InterpolationAlpha = 1;
 		}
 
+		// after the step, so the log also holds the state it ended in
+		if (InputLog != nullptr) {
+			InputLog->RecordFrame(*this, input, substeps, iterations, deltaTime);
+		}
 }
 
 
 //check overlap of a node with the mouse
-Vector2 RopePhysicsSolver::FindNodeToMove(Rope& rope, Camera2D& Camera) {
+Vector2 RopePhysicsSolver::FindNodeToMove(const InteractionInput& input, const bool dragPressed) {
 
-	if (IsMouseButtonDown(MOUSE_BUTTON_LEFT)) {
+	// only on the click itself: holding the button and moving over a rope doesn't grab it, and the index isn't rebuilt every step
+	if (dragPressed && config.interaction.draggedRope.IsNull() && config.interaction.canDrag && !AllRopes.empty()) {
 
 		//get cursor world position
-		Vector2 cursorWorldPos = GetScreenToWorld2D(GetMousePosition(), Camera);
+		Vector2 cursorWorldPos = input.cursorWorldPos;
+
+		// the index is only needed on a click, so it is built right here instead of every frame.
+		// cells as big as the largest node radius, so the query only looks at the 3x3 cells around the cursor
+		float maxRadius = 0;
+		for (const Rope& rope : AllRopes) {
+			maxRadius = std::max(maxRadius, rope.Radius);
+		}
+
+		// nothing can be under the cursor, and a cell size of 0 would put every node at an infinite cell
+		if (maxRadius <= 0) {
+			return { 0,0 };
+		}
 
+		PickingHash.Build(AllNodes.size(), [&](int i) { return AllNodes[i].Position; }, maxRadius, threadpool);
 
+		// of all nodes under the cursor take the one with the lowest index, i.e. the first rope in AllRopes wins like before
+		int pickedNode = -1;
 
-		if (config.interaction.draggedRope == nullptr && config.interaction.canDrag) {
+		PickingHash.ForEachNear(cursorWorldPos, maxRadius, [&](int i, Vector2 position) {
 
-			for (int i = rope.startNodeIndex; i < rope.startNodeIndex + rope.nodeAmount; i++) { //bruteforce. for every node in a rope, check overlap between the cursor and a node
-													// until we find the one that overlaps
-				if (Vector2Distance(cursorWorldPos, AllNodes[i].Position) < rope.Radius) {
-					config.interaction.draggedNodeID = i;	//found the node
-					config.interaction.draggedRope = &rope;
-					config.interaction.wasAnchored = AllNodes[config.interaction.draggedNodeID].IsAnchored;	//check if it was anchored to return to this state after LMB is no longer being held
-					
-					break;
-				}
+			if (pickedNode != -1 && i >= pickedNode) return;
 
+			if (Vector2Distance(cursorWorldPos, position) < AllRopes[AllNodes[i].RopeID].Radius) {
+				pickedNode = i;
 			}
+		});
+
+		if (pickedNode != -1) {
+
+			Rope& rope = AllRopes[AllNodes[pickedNode].RopeID];
+
+			config.interaction.draggedNodeID = pickedNode;	//found the node
+			config.interaction.draggedRope = rope.handle;
+			WakeRope(rope);
+			config.interaction.wasAnchored = AllNodes[pickedNode].IsAnchored;	//check if it was anchored to return to this state after LMB is no longer being held
 		}
 	}
 
 	//get the position at which the dragging will start. must call every frame
 	Vector2 dragStartFramePos = { 0,0 };
-	// Only access the node if this rope is the one being dragged
-	if (config.interaction.draggedRope == &rope && config.interaction.draggedNodeID != -1) {
+	if (!config.interaction.draggedRope.IsNull() && config.interaction.draggedNodeID != -1) {
 		dragStartFramePos = AllNodes[config.interaction.draggedNodeID].Position;
 	}
 
 	return dragStartFramePos;
 }
 
-void RopePhysicsSolver::ToggleAnchor(Rope& rope)
+void RopePhysicsSolver::ToggleAnchor(Rope& rope, const InteractionInput& input)
 {
-	if (config.interaction.draggedRope != nullptr) {
+	if (!config.interaction.draggedRope.IsNull()) {
 
-		if (&rope == config.interaction.draggedRope && IsKeyPressed(KEY_LEFT_CONTROL)) {	//if control is pressed (and we are checking thr correct rope), change whether or not the node is anchored
+		if (rope.handle == config.interaction.draggedRope && input.toggleAnchorPressed) {	//if control is pressed (and we are checking thr correct rope), change whether or not the node is anchored
 
 			config.interaction.wasAnchored = !config.interaction.wasAnchored;
 			AllNodes[config.interaction.draggedNodeID].IsAnchored = !AllNodes[config.interaction.draggedNodeID].IsAnchored;
+			WakeRope(rope);
 		}
 	}
 }
 
 //moves the node to the cursors position
-void RopePhysicsSolver::MoveRopeNode(Rope& rope, const Camera2D& mainCamera, const int substeps, const int i, const Vector2 dragStartFramePos) {
+void RopePhysicsSolver::MoveRopeNode(Rope& rope, const InteractionInput& input, const int substeps, const int i, const Vector2 dragStartFramePos) {
 
-	Vector2 cursorWorldPos = GetScreenToWorld2D(GetMousePosition(), mainCamera);
+	Vector2 cursorWorldPos = input.cursorWorldPos;
 	int& draggedNodeID = config.interaction.draggedNodeID;
 
-	if (IsMouseButtonDown(MOUSE_BUTTON_LEFT)) {
+	if (input.dragHeld) {
 
 		//Only proceed if THIS specific rope is the one being dragged
-		if (config.interaction.draggedRope != &rope) return;
+		if (config.interaction.draggedRope != rope.handle) return;
 
 		//anchore the node thats being dragged
 		AllNodes[draggedNodeID].IsAnchored = true;
@@ -292,12 +1743,17 @@ void RopePhysicsSolver::MoveRopeNode(Rope& rope, const Camera2D& mainCamera, con
 			}
 
 	}
+}
+
+//stop dragging the node
+void RopePhysicsSolver::ReleaseRopeNode(Rope& rope, const InteractionInput& input) {
+
+	int& draggedNodeID = config.interaction.draggedNodeID;
 
-	//stop dragging the node
-	if (IsMouseButtonReleased(MOUSE_BUTTON_LEFT)) {
+	if (input.dragReleased) {
 
 		//check if we are in the correct rope
-		if (config.interaction.draggedRope != &rope) return;
+		if (config.interaction.draggedRope != rope.handle) return;
 
 		if (config.interaction.draggedNodeID != -1) {	//return the node to its state before dragging
 
@@ -311,7 +1767,7 @@ void RopePhysicsSolver::MoveRopeNode(Rope& rope, const Camera2D& mainCamera, con
 			}
 			//reset config
 			draggedNodeID = -1;
-			config.interaction.draggedRope = nullptr;
+			config.interaction.draggedRope = RopeHandle{};
 		}
 	}
 }
\ No newline at end of file
@@ -20,13 +20,19 @@ void RopeRenderer::DrawSquaresBatched(const std::vector<Vector2>& positions, flo
 	rlEnd();
 }
 
-void RopeRenderer::RenderRopes(Camera2D& camera, Rope& rope, std::vector<RopeNode>& nodes) {
+void RopeRenderer::RenderRopes(Camera2D& camera, Rope& rope, NodeArray<RopeNode>& nodes, const std::vector<Vector2>& previousPositions, float alpha) {
 
+	// lambda to get the interpolated position of a node (nodes created after the last step have no previous position)
+	auto nodePosition = [&](int i) {
+
+		if (alpha >= 1 || i >= (int)previousPositions.size()) return nodes[i].Position;
+		return Vector2Lerp(previousPositions[i], nodes[i].Position, alpha);
+		};
 
 	// lambda to check if a node is visible
 	auto isVisible = [&](int i, float rad) {
 
-		Vector2 nodeScreenPos = GetWorldToScreen2D(nodes[i].Position, camera);
+		Vector2 nodeScreenPos = GetWorldToScreen2D(nodePosition(i), camera);
 		float nodeRadiusscreen = rad * camera.zoom;
 
 		return (nodeScreenPos.x + nodeRadiusscreen >= 0 && nodeScreenPos.x - nodeRadiusscreen <= GetScreenWidth() &&
@@ -44,16 +50,16 @@ void RopeRenderer::RenderRopes(Camera2D& camera, Rope& rope, std::vector<RopeNod
 		if (isVisible(i, radius)) {
 
 			// If entering screen from outside: include previous off-screen node to avoid gaps
-			if (batch.empty() && i > rope.startNodeIndex) batch.push_back(nodes[i - 1].Position); // Entering
+			if (batch.empty() && i > rope.startNodeIndex) batch.push_back(nodePosition(i - 1)); // Entering
 
 			// // Add other visible node to batch
-			batch.push_back(nodes[i].Position);
+			batch.push_back(nodePosition(i));
 
 		}
 		else if (!batch.empty()) {
 
 			//if the node is invisible and we're not at the start, add the last node, draw the rope, clear the batch
-			batch.push_back(nodes[i].Position); // Exiting
+			batch.push_back(nodePosition(i)); // Exiting
 			DrawSplineLinear(batch.data(), batch.size(), radius, RED);
 			DrawSquaresBatched(batch, radius * 2.0f, GREEN);
 			batch.clear();
@@ -66,4 +72,28 @@ void RopeRenderer::RenderRopes(Camera2D& camera, Rope& rope, std::vector<RopeNod
 		DrawSquaresBatched(batch, radius * 2.0f, GREEN);
 		batch.clear();
 	}
-}
\ No newline at end of file
+}
+void RopeRenderer::RenderAllRopes(Camera2D& camera, RopePhysicsSolver& solver) {
+
+	for (Rope& rope : solver.AllRopes) {
+		RenderRopes(camera, rope, solver.AllNodes, solver.PreviousPositions, solver.InterpolationAlpha);
+	}
+}
+
+void RopeRenderer::RenderColliders(const ColliderWorld& colliders, Color color) {
+
+	for (const Collider& collider : colliders.GetColliders()) {
+
+		switch (collider.shape) {
+		case ColliderShape::Segment:
+			DrawLineEx(collider.a, collider.b, 3, color);
+			break;
+		case ColliderShape::Box:
+			DrawRectangleLinesEx(Rectangle{ collider.a.x, collider.a.y, collider.b.x - collider.a.x, collider.b.y - collider.a.y }, 3, color);
+			break;
+		case ColliderShape::Circle:
+			DrawCircleLinesV(collider.a, collider.radius, color);
+			break;
+		}
+	}
+}
@@ -0,0 +1,125 @@
+#include "RopeShapes.h"
+#include <algorithm>
+#include <cmath>
+
+RopeShapeSampler::RopeShapeSampler(const RopeDescriptor& ropeDescriptor) :
+
+	descriptor(&ropeDescriptor),
+	shape(ropeDescriptor.shape),
+	direction(Vector2Normalize(ropeDescriptor.direction))
+{
+	if (Vector2LengthSqr(direction) == 0) direction = { 1,0 };
+
+	if (shape == RopeShape::Catenary) {
+
+		Vector2 start = ropeDescriptor.firstNodePos;
+		Vector2 end = ropeDescriptor.endPos;
+
+		// math coordinates: y up, and the end right of the start
+		catenaryMirror = end.x >= start.x ? 1.0f : -1.0f;
+		double x1 = catenaryMirror * start.x;
+		double x2 = catenaryMirror * end.x;
+		double y1 = -start.y;
+		double y2 = -end.y;
+
+		double h = x2 - x1;
+		double v = y2 - y1;
+		double length = (double)ropeDescriptor.ropeLengthForEach * (ropeDescriptor.nodeAmount - 1);
+		double target = sqrt(std::max(0.0, length * length - v * v));
+
+		// too short to sag, or hanging straight down: lay it out as a straight line towards the end
+		if (h < 1e-3 || target <= h * 1.0001) {
+
+			shape = RopeShape::Line;
+			direction = Vector2LengthSqr(end - start) > 0 ? Vector2Normalize(end - start) : direction;
+			return;
+		}
+
+		// find a with 2a * sinh(h / 2a) = sqrt(length^2 - v^2). the left side falls with a, so bisect (on a log scale)
+		double low = h * 1e-6;
+		double high = h * 1e6;
+
+		for (int step = 0; step < 100; step++) {
+
+			double a = sqrt(low * high);
+			if (2 * a * sinh(h / (2 * a)) > target) low = a;
+			else high = a;
+		}
+
+		catenaryA = sqrt(low * high);
+		catenaryU1 = atanh(v / length) - h / (2 * catenaryA);
+		catenaryX0 = x1 - catenaryA * catenaryU1;
+		catenaryY1 = y1;
+	}
+
+	if (shape == RopeShape::Polyline) {
+
+		polylineDistances.resize(ropeDescriptor.points.size() + 1);
+		polylineDistances[0] = 0;
+
+		Vector2 previous = ropeDescriptor.firstNodePos;
+		for (size_t p = 0; p < ropeDescriptor.points.size(); p++) {
+
+			polylineDistances[p + 1] = polylineDistances[p] + Vector2Distance(previous, ropeDescriptor.points[p]);
+			previous = ropeDescriptor.points[p];
+		}
+	}
+}
+
+Vector2 RopeShapeSampler::NodePosition(int i) const {
+
+	float distance = descriptor->ropeLengthForEach * i;
+
+	switch (shape) {
+	case RopeShape::Catenary:	return CatenaryPosition(distance);
+	case RopeShape::Polyline:	return PolylinePosition(distance);
+	case RopeShape::Spiral:		return SpiralPosition(distance);
+	default:					return descriptor->firstNodePos + direction * distance;
+	}
+}
+
+// arc length from u1 is a * (sinh(u) - sinh(u1)), solved for u
+Vector2 RopeShapeSampler::CatenaryPosition(float distance) const {
+
+	double u = asinh(distance / catenaryA + sinh(catenaryU1));
+	double x = catenaryX0 + catenaryA * u;
+	double y = catenaryY1 + catenaryA * (cosh(u) - cosh(catenaryU1));
+
+	return Vector2{ catenaryMirror * (float)x, -(float)y };
+}
+
+Vector2 RopeShapeSampler::PolylinePosition(float distance) const {
+
+	const std::vector<Vector2>& points = descriptor->points;
+	Vector2 start = descriptor->firstNodePos;
+
+	if (points.empty()) return start + direction * distance;
+
+	// segment the distance falls into, or the last one if the rope is longer than the polyline
+	int segment = std::upper_bound(polylineDistances.begin(), polylineDistances.end(), distance) - polylineDistances.begin() - 1;
+	segment = std::clamp(segment, 0, (int)points.size() - 1);
+
+	Vector2 from = segment == 0 ? start : points[segment - 1];
+	Vector2 to = points[segment];
+	float segmentLength = polylineDistances[segment + 1] - polylineDistances[segment];
+
+	if (segmentLength == 0) return from;
+
+	return from + (to - from) * ((distance - polylineDistances[segment]) / segmentLength);
+}
+
+// r = b * theta. the arc length up to theta is b / 2 * (theta * sqrt(1 + theta^2) + asinh(theta)), solved for theta with Newton
+Vector2 RopeShapeSampler::SpiralPosition(float distance) const {
+
+	double b = std::max(descriptor->spiralSpacing, 0.001f) / (2 * PI);
+	double theta = sqrt(2 * distance / b);
+
+	for (int step = 0; step < 8 && theta > 0; step++) {
+
+		double arcLength = b / 2 * (theta * sqrt(1 + theta * theta) + asinh(theta));
+		theta -= (arcLength - distance) / (b * sqrt(1 + theta * theta));
+	}
+
+	double radius = b * theta;
+	return descriptor->firstNodePos + Vector2{ (float)(radius * cos(theta)), (float)(radius * sin(theta)) };
+}
@@ -0,0 +1,303 @@
+#include "SimdIntegrator.h"
+#include <cmath>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+	#define ROPE_SIMD_X86 1
+	#include <immintrin.h>
+
+	#if defined(_MSC_VER) && !defined(__clang__)
+		#include <intrin.h>
+		// msvc lets us use any intrinsic without extra compiler flags
+		#define ROPE_TARGET_AVX2
+		#define ROPE_TARGET_AVX512
+	#else
+		// gcc/clang only compile these functions for the wider instruction sets, the rest of the program stays baseline
+		#define ROPE_TARGET_AVX2 __attribute__((target("avx2")))
+		#define ROPE_TARGET_AVX512 __attribute__((target("avx512f")))
+	#endif
+#else
+	#define ROPE_SIMD_X86 0
+#endif
+
+
+// read 'count' (up to 16) anchor bits starting at node i
+static inline uint32_t GetAnchorMask(const RopeNodeStore& store, int i, int count) {
+
+	int word = i >> 6;
+	int shift = i & 63;
+
+	uint64_t bits = store.anchorBits[word] >> shift;
+
+	// the bits continue in the next word
+	if (shift + count > 64 && word + 1 < store.WordCount()) {
+		bits |= store.anchorBits[word + 1] << (64 - shift);
+	}
+
+	return (uint32_t)(bits & ((uint64_t(1) << count) - 1));
+}
+
+
+static void IntegrateNodesScalar(RopeNodeStore& store, int begin, int end, const IntegrationParams& params) {
+
+	float dt = params.deltaTime;
+	// hoisted like in the vector kernels: a * dt * dt would round differently, and this kernel also does their tails
+	const float dtSquared = dt * dt;
+	// the original damping only kicks in above a speed of 0.01
+	float minLength = 0.01f * dt;
+
+	for (int i = begin; i < end; i++) {
+
+		if (store.IsAnchored(i)) {
+			store.accX[i] = 0;
+			store.accY[i] = 0;
+			continue;
+		}
+
+		float velocityX = store.x[i] - store.oldX[i];
+		float velocityY = store.y[i] - store.oldY[i];
+		float length = sqrtf(velocityX * velocityX + velocityY * velocityY);
+
+		float dragFactor = 1;
+		if (length > minLength) {
+			dragFactor = 1 - params.dragConstant * length;
+			if (dragFactor < 0) { dragFactor = 0; }
+		}
+
+		float accelerationX = store.accX[i] + params.g.x;
+		float accelerationY = store.accY[i] + params.g.y;
+
+		store.oldX[i] = store.x[i];
+		store.oldY[i] = store.y[i];
+		store.x[i] = store.oldX[i] + velocityX * dragFactor + accelerationX * dtSquared;
+		store.y[i] = store.oldY[i] + velocityY * dragFactor + accelerationY * dtSquared;
+
+		store.accX[i] = 0;
+		store.accY[i] = 0;
+	}
+}
+
+#if ROPE_SIMD_X86
+
+// SSE2 is part of every x64 cpu, so this is the baseline vector path
+static void IntegrateNodesSSE(RopeNodeStore& store, int begin, int end, const IntegrationParams& params) {
+
+	const __m128 dt = _mm_set1_ps(params.deltaTime);
+	const __m128 dtSquared = _mm_mul_ps(dt, dt);
+	const __m128 gX = _mm_set1_ps(params.g.x);
+	const __m128 gY = _mm_set1_ps(params.g.y);
+	const __m128 dragConstant = _mm_set1_ps(params.dragConstant);
+	const __m128 minLength = _mm_set1_ps(0.01f * params.deltaTime);
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128i laneBits = _mm_setr_epi32(1, 2, 4, 8);
+
+	int i = begin;
+
+	for (; i + 4 <= end; i += 4) {
+
+		// anchor bits of these 4 nodes
+		uint32_t anchors = GetAnchorMask(store, i, 4);
+
+		__m128 x = _mm_loadu_ps(&store.x[i]);
+		__m128 y = _mm_loadu_ps(&store.y[i]);
+		__m128 oldX = _mm_loadu_ps(&store.oldX[i]);
+		__m128 oldY = _mm_loadu_ps(&store.oldY[i]);
+		__m128 accX = _mm_add_ps(_mm_loadu_ps(&store.accX[i]), gX);
+		__m128 accY = _mm_add_ps(_mm_loadu_ps(&store.accY[i]), gY);
+
+		__m128 velocityX = _mm_sub_ps(x, oldX);
+		__m128 velocityY = _mm_sub_ps(y, oldY);
+		__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(velocityX, velocityX), _mm_mul_ps(velocityY, velocityY)));
+
+		// quadratic drag, only above the minimum speed
+		__m128 dragFactor = _mm_max_ps(_mm_sub_ps(one, _mm_mul_ps(dragConstant, length)), zero);
+		__m128 isMoving = _mm_cmpgt_ps(length, minLength);
+		dragFactor = _mm_or_ps(_mm_and_ps(isMoving, dragFactor), _mm_andnot_ps(isMoving, one));
+
+		__m128 nextX = _mm_add_ps(_mm_add_ps(x, _mm_mul_ps(velocityX, dragFactor)), _mm_mul_ps(accX, dtSquared));
+		__m128 nextY = _mm_add_ps(_mm_add_ps(y, _mm_mul_ps(velocityY, dragFactor)), _mm_mul_ps(accY, dtSquared));
+
+		// anchored lanes keep both their position and old position
+		__m128 isAnchored = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32((int)anchors), laneBits), laneBits));
+
+		_mm_storeu_ps(&store.x[i], _mm_or_ps(_mm_and_ps(isAnchored, x), _mm_andnot_ps(isAnchored, nextX)));
+		_mm_storeu_ps(&store.y[i], _mm_or_ps(_mm_and_ps(isAnchored, y), _mm_andnot_ps(isAnchored, nextY)));
+		_mm_storeu_ps(&store.oldX[i], _mm_or_ps(_mm_and_ps(isAnchored, oldX), _mm_andnot_ps(isAnchored, x)));
+		_mm_storeu_ps(&store.oldY[i], _mm_or_ps(_mm_and_ps(isAnchored, oldY), _mm_andnot_ps(isAnchored, y)));
+		_mm_storeu_ps(&store.accX[i], zero);
+		_mm_storeu_ps(&store.accY[i], zero);
+	}
+
+	// the rest of the nodes
+	IntegrateNodesScalar(store, i, end, params);
+}
+
+ROPE_TARGET_AVX2
+static void IntegrateNodesAVX2(RopeNodeStore& store, int begin, int end, const IntegrationParams& params) {
+
+	const __m256 dt = _mm256_set1_ps(params.deltaTime);
+	const __m256 dtSquared = _mm256_mul_ps(dt, dt);
+	const __m256 gX = _mm256_set1_ps(params.g.x);
+	const __m256 gY = _mm256_set1_ps(params.g.y);
+	const __m256 dragConstant = _mm256_set1_ps(params.dragConstant);
+	const __m256 minLength = _mm256_set1_ps(0.01f * params.deltaTime);
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256i laneBits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+
+	int i = begin;
+
+	for (; i + 8 <= end; i += 8) {
+
+		uint32_t anchors = GetAnchorMask(store, i, 8);
+
+		__m256 x = _mm256_loadu_ps(&store.x[i]);
+		__m256 y = _mm256_loadu_ps(&store.y[i]);
+		__m256 oldX = _mm256_loadu_ps(&store.oldX[i]);
+		__m256 oldY = _mm256_loadu_ps(&store.oldY[i]);
+		__m256 accX = _mm256_add_ps(_mm256_loadu_ps(&store.accX[i]), gX);
+		__m256 accY = _mm256_add_ps(_mm256_loadu_ps(&store.accY[i]), gY);
+
+		__m256 velocityX = _mm256_sub_ps(x, oldX);
+		__m256 velocityY = _mm256_sub_ps(y, oldY);
+		__m256 length = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(velocityX, velocityX), _mm256_mul_ps(velocityY, velocityY)));
+
+		__m256 dragFactor = _mm256_max_ps(_mm256_sub_ps(one, _mm256_mul_ps(dragConstant, length)), zero);
+		dragFactor = _mm256_blendv_ps(one, dragFactor, _mm256_cmp_ps(length, minLength, _CMP_GT_OQ));
+
+		__m256 nextX = _mm256_add_ps(_mm256_add_ps(x, _mm256_mul_ps(velocityX, dragFactor)), _mm256_mul_ps(accX, dtSquared));
+		__m256 nextY = _mm256_add_ps(_mm256_add_ps(y, _mm256_mul_ps(velocityY, dragFactor)), _mm256_mul_ps(accY, dtSquared));
+
+		__m256 isAnchored = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32((int)anchors), laneBits), laneBits));
+
+		_mm256_storeu_ps(&store.x[i], _mm256_blendv_ps(nextX, x, isAnchored));
+		_mm256_storeu_ps(&store.y[i], _mm256_blendv_ps(nextY, y, isAnchored));
+		_mm256_storeu_ps(&store.oldX[i], _mm256_blendv_ps(x, oldX, isAnchored));
+		_mm256_storeu_ps(&store.oldY[i], _mm256_blendv_ps(y, oldY, isAnchored));
+		_mm256_storeu_ps(&store.accX[i], zero);
+		_mm256_storeu_ps(&store.accY[i], zero);
+	}
+
+	IntegrateNodesScalar(store, i, end, params);
+}
+
+ROPE_TARGET_AVX512
+static void IntegrateNodesAVX512(RopeNodeStore& store, int begin, int end, const IntegrationParams& params) {
+
+	const __m512 dt = _mm512_set1_ps(params.deltaTime);
+	const __m512 dtSquared = _mm512_mul_ps(dt, dt);
+	const __m512 gX = _mm512_set1_ps(params.g.x);
+	const __m512 gY = _mm512_set1_ps(params.g.y);
+	const __m512 dragConstant = _mm512_set1_ps(params.dragConstant);
+	const __m512 minLength = _mm512_set1_ps(0.01f * params.deltaTime);
+	const __m512 one = _mm512_set1_ps(1.0f);
+	const __m512 zero = _mm512_setzero_ps();
+	// the unmasked sqrt and max intrinsics pass an undefined vector as their (unused) merge source, which gcc warns about.
+	// the zero-masked versions with every lane set compile to the same instructions
+	const __mmask16 allLanes = 0xFFFF;
+
+	int i = begin;
+
+	for (; i + 16 <= end; i += 16) {
+
+		// the anchor bits already are a lane mask
+		__mmask16 isAnchored = (__mmask16)GetAnchorMask(store, i, 16);
+
+		__m512 x = _mm512_loadu_ps(&store.x[i]);
+		__m512 y = _mm512_loadu_ps(&store.y[i]);
+		__m512 oldX = _mm512_loadu_ps(&store.oldX[i]);
+		__m512 oldY = _mm512_loadu_ps(&store.oldY[i]);
+		__m512 accX = _mm512_add_ps(_mm512_loadu_ps(&store.accX[i]), gX);
+		__m512 accY = _mm512_add_ps(_mm512_loadu_ps(&store.accY[i]), gY);
+
+		__m512 velocityX = _mm512_sub_ps(x, oldX);
+		__m512 velocityY = _mm512_sub_ps(y, oldY);
+		__m512 length = _mm512_maskz_sqrt_ps(allLanes, _mm512_add_ps(_mm512_mul_ps(velocityX, velocityX), _mm512_mul_ps(velocityY, velocityY)));
+
+		__m512 dragFactor = _mm512_maskz_max_ps(allLanes, _mm512_sub_ps(one, _mm512_mul_ps(dragConstant, length)), zero);
+		dragFactor = _mm512_mask_blend_ps(_mm512_cmp_ps_mask(length, minLength, _CMP_GT_OQ), one, dragFactor);
+
+		__m512 nextX = _mm512_add_ps(_mm512_add_ps(x, _mm512_mul_ps(velocityX, dragFactor)), _mm512_mul_ps(accX, dtSquared));
+		__m512 nextY = _mm512_add_ps(_mm512_add_ps(y, _mm512_mul_ps(velocityY, dragFactor)), _mm512_mul_ps(accY, dtSquared));
+
+		_mm512_storeu_ps(&store.x[i], _mm512_mask_blend_ps(isAnchored, nextX, x));
+		_mm512_storeu_ps(&store.y[i], _mm512_mask_blend_ps(isAnchored, nextY, y));
+		_mm512_storeu_ps(&store.oldX[i], _mm512_mask_blend_ps(isAnchored, x, oldX));
+		_mm512_storeu_ps(&store.oldY[i], _mm512_mask_blend_ps(isAnchored, y, oldY));
+		_mm512_storeu_ps(&store.accX[i], zero);
+		_mm512_storeu_ps(&store.accY[i], zero);
+	}
+
+	IntegrateNodesScalar(store, i, end, params);
+}
+
+#endif
+
+
+SimdLevel DetectSimdLevel() {
+
+#if ROPE_SIMD_X86
+	#if defined(_MSC_VER) && !defined(__clang__)
+
+		int info[4];
+		__cpuid(info, 1);
+
+		bool hasSSE2 = (info[3] & (1 << 26)) != 0;
+		bool hasOSXSAVE = (info[2] & (1 << 27)) != 0;
+
+		if (!hasSSE2) return SimdLevel::Scalar;
+		if (!hasOSXSAVE) return SimdLevel::SSE;
+
+		// check that the os saves the ymm (and zmm) registers
+		unsigned long long xcr0 = _xgetbv(0);
+		bool osSupportsAVX = (xcr0 & 0x6) == 0x6;
+		bool osSupportsAVX512 = (xcr0 & 0xE6) == 0xE6;
+
+		__cpuidex(info, 7, 0);
+		bool hasAVX2 = (info[1] & (1 << 5)) != 0;
+		bool hasAVX512F = (info[1] & (1 << 16)) != 0;
+
+		if (hasAVX512F && osSupportsAVX512) return SimdLevel::AVX512;
+		if (hasAVX2 && osSupportsAVX) return SimdLevel::AVX2;
+		return SimdLevel::SSE;
+
+	#else
+
+		// also checks for os support
+		__builtin_cpu_init();
+
+		if (__builtin_cpu_supports("avx512f")) return SimdLevel::AVX512;
+		if (__builtin_cpu_supports("avx2")) return SimdLevel::AVX2;
+		if (__builtin_cpu_supports("sse2")) return SimdLevel::SSE;
+		return SimdLevel::Scalar;
+
+	#endif
+#else
+	return SimdLevel::Scalar;
+#endif
+}
+
+const char* GetSimdLevelName(SimdLevel level) {
+
+	switch (level) {
+		case SimdLevel::SSE: return "SSE";
+		case SimdLevel::AVX2: return "AVX2";
+		case SimdLevel::AVX512: return "AVX-512";
+		default: return "Scalar";
+	}
+}
+
+void IntegrateNodes(RopeNodeStore& store, int begin, int end, const IntegrationParams& params, SimdLevel level) {
+
+#if ROPE_SIMD_X86
+	switch (level) {
+		case SimdLevel::AVX512: IntegrateNodesAVX512(store, begin, end, params); return;
+		case SimdLevel::AVX2: IntegrateNodesAVX2(store, begin, end, params); return;
+		case SimdLevel::SSE: IntegrateNodesSSE(store, begin, end, params); return;
+		default: break;
+	}
+#endif
+
+	IntegrateNodesScalar(store, begin, end, params);
+}
@@ -0,0 +1,150 @@
+#include "ThreadAffinity.h"
+#include <algorithm>
+#include <thread>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <fstream>
+#include <string>
+#endif
+
+namespace {
+
+	struct LogicalCpu
+	{
+		int id;
+		int package;
+		int core;
+		int smtIndex;	// 0 for the first logical cpu of a physical core, 1 for its sibling and so on
+	};
+
+	std::vector<LogicalCpu> ReadCpuTopology() {
+
+		std::vector<LogicalCpu> cpus;
+
+#if defined(_WIN32)
+
+		DWORD length = 0;
+		GetLogicalProcessorInformation(nullptr, &length);
+		std::vector<SYSTEM_LOGICAL_PROCESSOR_INFORMATION> info(length / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION));
+
+		if (info.empty() || !GetLogicalProcessorInformation(info.data(), &length)) return cpus;
+
+		DWORD_PTR processMask = 0, systemMask = 0;
+		GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask);
+
+		std::vector<ULONG_PTR> packageMasks;
+		for (const SYSTEM_LOGICAL_PROCESSOR_INFORMATION& entry : info) {
+			if (entry.Relationship == RelationProcessorPackage) packageMasks.push_back(entry.ProcessorMask);
+		}
+
+		int core = 0;
+		for (const SYSTEM_LOGICAL_PROCESSOR_INFORMATION& entry : info) {
+
+			if (entry.Relationship != RelationProcessorCore) continue;
+
+			int smtIndex = 0;
+			for (int bit = 0; bit < (int)sizeof(ULONG_PTR) * 8; bit++) {
+
+				ULONG_PTR cpuBit = (ULONG_PTR)1 << bit;
+				if (!(entry.ProcessorMask & cpuBit)) continue;
+
+				int package = 0;
+				for (int p = 0; p < (int)packageMasks.size(); p++) {
+					if (packageMasks[p] & cpuBit) package = p;
+				}
+
+				if (processMask & cpuBit) cpus.push_back({ bit, package, core, smtIndex });
+				smtIndex++;
+			}
+			core++;
+		}
+
+#elif defined(__linux__)
+
+		cpu_set_t allowed;
+		CPU_ZERO(&allowed);
+		if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return cpus;
+
+		auto readNumber = [](int cpu, const char* file) {
+
+			std::ifstream stream("/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/" + file);
+			int value = 0;
+			if (!(stream >> value)) value = cpu;	// no topology info, treat every cpu as its own core
+			return value;
+		};
+
+		for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+
+			if (!CPU_ISSET(cpu, &allowed)) continue;
+
+			LogicalCpu logical = { cpu, readNumber(cpu, "physical_package_id"), readNumber(cpu, "core_id"), 0 };
+
+			for (const LogicalCpu& other : cpus) {
+				if (other.package == logical.package && other.core == logical.core) logical.smtIndex++;
+			}
+			cpus.push_back(logical);
+		}
+
+#else
+
+		// no topology information, keep the numbering of the os
+		int count = std::thread::hardware_concurrency();
+		for (int cpu = 0; cpu < count; cpu++) {
+			cpus.push_back({ cpu, 0, cpu, 0 });
+		}
+
+#endif
+
+		return cpus;
+	}
+}
+
+std::vector<int> GetCpuPinningOrder(bool avoidSmtSiblings) {
+
+	std::vector<LogicalCpu> cpus = ReadCpuTopology();
+
+	std::stable_sort(cpus.begin(), cpus.end(), [&](const LogicalCpu& a, const LogicalCpu& b) {
+
+		if (avoidSmtSiblings && a.smtIndex != b.smtIndex) return a.smtIndex < b.smtIndex;
+		if (a.package != b.package) return a.package < b.package;
+		if (a.core != b.core) return a.core < b.core;
+		return a.smtIndex < b.smtIndex;
+	});
+
+	std::vector<int> order;
+	for (const LogicalCpu& cpu : cpus) {
+		order.push_back(cpu.id);
+	}
+	return order;
+}
+
+bool PinCurrentThreadToCpu(int cpu) {
+
+#if defined(_WIN32)
+
+	if (cpu < 0 || cpu >= (int)sizeof(DWORD_PTR) * 8) return false;
+	return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu) != 0;
+
+#elif defined(__linux__)
+
+	if (cpu < 0 || cpu >= CPU_SETSIZE) return false;
+
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+
+#else
+
+	// macOS only has affinity hints, and no way to pin a thread
+	(void)cpu;
+	return false;
+
+#endif
+}
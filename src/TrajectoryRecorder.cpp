@@ -0,0 +1,393 @@
+#include "TrajectoryRecorder.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+	// quantized positions (and predictions) are kept below 2^30, so the difference of two of them always fits into an int32
+	constexpr double MaxQuantized = (1 << 30) - 1;
+	// Rice codes with a quotient this large are written as an escape (that many ones) followed by the raw 32 bit value
+	constexpr int RiceEscape = 24;
+	constexpr int RiceParameterBits = 5;
+
+	// in double, float would lose the low bits of large coordinates before rounding
+	int32_t Quantize(float value, double inversePrecision) {
+
+		double scaled = value * inversePrecision;
+		if (!(scaled == scaled)) return 0;	// NaN
+		return (int32_t)lrint(std::clamp(scaled, -MaxQuantized, MaxQuantized));
+	}
+
+	uint32_t ZigZag(int32_t value) { return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31); }
+	int32_t UnZigZag(uint32_t value) { return (int32_t)(value >> 1) ^ -(int32_t)(value & 1); }
+
+	// where a node is expected in this frame: nowhere for keyframes, where it was right after one,
+	// and after that moving on with the speed it had between the last two frames (nodes move smoothly, so what's left is small)
+	int32_t Predict(int framesSinceKeyframe, int32_t previous, int32_t older) {
+
+		if (framesSinceKeyframe == 0) return 0;
+		if (framesSinceKeyframe == 1) return previous;
+		return (int32_t)std::clamp(2 * (int64_t)previous - older, -(int64_t)MaxQuantized, (int64_t)MaxQuantized);
+	}
+
+	// least significant bit first
+	struct BitWriter
+	{
+		std::vector<uint8_t>& bytes;
+		uint64_t buffer = 0;
+		int bitCount = 0;
+
+		// count <= 32, value must not have bits above count
+		void Write(uint32_t value, int count) {
+
+			buffer |= (uint64_t)value << bitCount;
+			bitCount += count;
+
+			if (bitCount >= 32) {
+				uint8_t word[4] = { (uint8_t)buffer, (uint8_t)(buffer >> 8), (uint8_t)(buffer >> 16), (uint8_t)(buffer >> 24) };
+				bytes.insert(bytes.end(), word, word + 4);
+				buffer >>= 32;
+				bitCount -= 32;
+			}
+		}
+
+		void Flush() {
+
+			while (bitCount > 0) {
+				bytes.push_back((uint8_t)buffer);
+				buffer >>= 8;
+				bitCount -= 8;
+			}
+			buffer = 0;
+			bitCount = 0;
+		}
+	};
+
+	struct BitReader
+	{
+		const uint8_t* bytes;
+		size_t size;
+		size_t position = 0;
+		uint64_t buffer = 0;
+		int bitCount = 0;
+
+		// false once it ran past the end
+		bool Read(int count, uint32_t& value) {
+
+			while (bitCount < count) {
+
+				if (position == size) return false;
+				buffer |= (uint64_t)bytes[position++] << bitCount;
+				bitCount += 8;
+			}
+
+			value = (uint32_t)(buffer & ((uint64_t(1) << count) - 1));
+			buffer >>= count;
+			bitCount -= count;
+			return true;
+		}
+	};
+
+	// Rice code every block of values with the parameter that fits its average
+	void EncodeValues(const std::vector<uint32_t>& values, std::vector<uint8_t>& bytes) {
+
+		BitWriter writer{ bytes };
+
+		for (size_t blockBegin = 0; blockBegin < values.size(); blockBegin += TrajectoryBlockSize) {
+
+			size_t blockEnd = std::min(values.size(), blockBegin + TrajectoryBlockSize);
+
+			uint64_t sum = 0;
+			for (size_t i = blockBegin; i < blockEnd; i++) sum += values[i];
+
+			uint32_t mean = (uint32_t)(sum / (blockEnd - blockBegin));
+			int k = mean > 0 ? std::bit_width(mean) - 1 : 0;
+			writer.Write(k, RiceParameterBits);
+
+			for (size_t i = blockBegin; i < blockEnd; i++) {
+
+				uint32_t quotient = values[i] >> k;
+
+				if (quotient < RiceEscape && quotient + 1 + k <= 32) {
+					// quotient ones and a zero, then the low k bits
+					uint32_t remainder = values[i] & ((1u << k) - 1);
+					writer.Write(((1u << quotient) - 1) | (remainder << (quotient + 1)), quotient + 1 + k);
+				}
+				else if (quotient < RiceEscape) {
+					writer.Write((1u << quotient) - 1, quotient + 1);
+					writer.Write(values[i] & ((1u << k) - 1), k);
+				}
+				else {
+					writer.Write((1u << RiceEscape) - 1, RiceEscape);
+					writer.Write(values[i], 32);
+				}
+			}
+		}
+
+		writer.Flush();
+	}
+
+	bool DecodeValues(const std::vector<uint8_t>& bytes, std::vector<uint32_t>& values) {
+
+		BitReader reader{ bytes.data(), bytes.size() };
+
+		for (size_t blockBegin = 0; blockBegin < values.size(); blockBegin += TrajectoryBlockSize) {
+
+			size_t blockEnd = std::min(values.size(), blockBegin + TrajectoryBlockSize);
+
+			uint32_t k;
+			if (!reader.Read(RiceParameterBits, k) || k > 31) return false;
+
+			for (size_t i = blockBegin; i < blockEnd; i++) {
+
+				uint32_t quotient = 0;
+				uint32_t bit = 1;
+
+				while (quotient < RiceEscape) {
+					if (!reader.Read(1, bit)) return false;
+					if (bit == 0) break;
+					quotient++;
+				}
+
+				if (quotient == RiceEscape) {
+					if (!reader.Read(32, values[i])) return false;
+					continue;
+				}
+
+				uint32_t remainder = 0;
+				if (k > 0 && !reader.Read(k, remainder)) return false;
+				values[i] = (quotient << k) | remainder;
+			}
+		}
+
+		return true;
+	}
+}
+
+bool TrajectoryRecorder::Open(const char* path, const TrajectoryRecorderOptions& recorderOptions) {
+
+	Close();
+
+	// also false for NaN
+	if (!(recorderOptions.precision > 0)) return false;
+
+	file.open(path, std::ios::binary | std::ios::trunc);
+	if (!file) return false;
+
+	options = recorderOptions;
+	options.keyframeInterval = std::max(options.keyframeInterval, 1);
+	options.maxQueuedFrames = std::max(options.maxQueuedFrames, 1);
+
+	TrajectoryFileHeader header = {};
+	std::copy(std::begin(TrajectoryMagic), std::end(TrajectoryMagic), header.magic);
+	header.version = TrajectoryVersion;
+	header.precision = options.precision;
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	previousPositions.clear();
+	olderPositions.clear();
+	frameIndex = 0;
+	framesSinceKeyframe = 0;
+	queueStalls = 0;
+	bytesWritten = sizeof(header);
+	writeFailed = !file.good();
+
+	frames.clear();
+	frames.resize(options.maxQueuedFrames);
+	freeFrames.clear();
+	for (QueuedFrame& frame : frames) freeFrames.push_back(&frame);
+	queuedFrames.clear();
+	isClosing = false;
+
+	writerThread = std::thread(&TrajectoryRecorder::WriterLoop, this);
+	return true;
+}
+
+bool TrajectoryRecorder::Close() {
+
+	if (!writerThread.joinable()) return false;
+
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		isClosing = true;
+	}
+	queueCondition.notify_all();
+	writerThread.join();
+
+	// closing flushes what is still buffered, which can fail as well
+	file.close();
+	if (file.fail()) writeFailed = true;
+
+	return !writeFailed;
+}
+
+void TrajectoryRecorder::RecordFrame(const RopeNode* nodes, int nodeCount, Threadpool& threadpool) {
+
+	if (!IsOpen()) return;
+
+	QueuedFrame* frame;
+	{
+		std::unique_lock<std::mutex> lock(queueMutex);
+
+		if (freeFrames.empty()) {
+			queueStalls++;
+			queueCondition.wait(lock, [&] { return !freeFrames.empty(); });
+		}
+
+		frame = freeFrames.back();
+		freeFrames.pop_back();
+	}
+
+	bool isKeyframe = frameIndex % options.keyframeInterval == 0 || (int)previousPositions.size() != 2 * nodeCount;
+	framesSinceKeyframe = isKeyframe ? 0 : framesSinceKeyframe + 1;
+
+	previousPositions.resize(2 * nodeCount);
+	olderPositions.resize(2 * nodeCount);
+	frame->header = { frameIndex, (uint32_t)nodeCount, isKeyframe, 0 };
+	frame->values.resize(2 * nodeCount);
+
+	double inversePrecision = 1.0 / options.precision;
+	int blockCount = (nodeCount + QuantizeBlockSize - 1) / QuantizeBlockSize;
+
+	threadpool.ParralelFor(0, blockCount, [&](int block) {
+
+		int end = std::min(nodeCount, (block + 1) * QuantizeBlockSize);
+
+		for (int i = block * QuantizeBlockSize; i < end; i++) {
+
+			int32_t x = Quantize(nodes[i].Position.x, inversePrecision);
+			int32_t y = Quantize(nodes[i].Position.y, inversePrecision);
+
+			int32_t predictedX = Predict(framesSinceKeyframe, previousPositions[2 * i], olderPositions[2 * i]);
+			int32_t predictedY = Predict(framesSinceKeyframe, previousPositions[2 * i + 1], olderPositions[2 * i + 1]);
+
+			frame->values[i] = ZigZag(x - predictedX);
+			frame->values[nodeCount + i] = ZigZag(y - predictedY);
+
+			olderPositions[2 * i] = previousPositions[2 * i];
+			olderPositions[2 * i + 1] = previousPositions[2 * i + 1];
+			previousPositions[2 * i] = x;
+			previousPositions[2 * i + 1] = y;
+		}
+	});
+
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		queuedFrames.push_back(frame);
+	}
+	queueCondition.notify_all();
+
+	frameIndex++;
+}
+
+void TrajectoryRecorder::WriterLoop() {
+
+	std::vector<uint8_t> payload;
+
+	while (true) {
+
+		QueuedFrame* frame;
+		{
+			std::unique_lock<std::mutex> lock(queueMutex);
+			queueCondition.wait(lock, [&] { return !queuedFrames.empty() || isClosing; });
+
+			// closing only stops once everything queued is written
+			if (queuedFrames.empty()) return;
+
+			frame = queuedFrames.front();
+			queuedFrames.pop_front();
+		}
+
+		// after a failed write the frames are only given back, a frame missing in the middle would break the differences after it
+		if (!writeFailed.load(std::memory_order_relaxed)) {
+
+			payload.clear();
+			EncodeValues(frame->values, payload);
+			frame->header.payloadBytes = payload.size();
+
+			file.write(reinterpret_cast<const char*>(&frame->header), sizeof(frame->header));
+			file.write(reinterpret_cast<const char*>(payload.data()), payload.size());
+
+			if (file.good()) {
+				bytesWritten.fetch_add(sizeof(frame->header) + payload.size(), std::memory_order_relaxed);
+			}
+			else {
+				writeFailed = true;
+			}
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(queueMutex);
+			freeFrames.push_back(frame);
+		}
+		queueCondition.notify_all();
+	}
+}
+
+bool TrajectoryReader::Open(const char* path) {
+
+	file.open(path, std::ios::binary);
+	if (!file) return false;
+
+	TrajectoryFileHeader header;
+	file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+	if (!file || !std::equal(std::begin(TrajectoryMagic), std::end(TrajectoryMagic), header.magic) || header.version != TrajectoryVersion ||
+		!(header.precision > 0)) {
+		file.close();
+		return false;
+	}
+
+	precision = header.precision;
+	previousPositions.clear();
+	olderPositions.clear();
+	framesSinceKeyframe = 0;
+	return true;
+}
+
+bool TrajectoryReader::ReadFrame(std::vector<Vector2>& positions) {
+
+	TrajectoryFrameHeader header;
+	file.read(reinterpret_cast<char*>(&header), sizeof(header));
+	if (!file) return false;
+
+	// differences need the frame before, with the same nodes
+	if (!header.isKeyframe && previousPositions.size() != 2 * (size_t)header.nodeCount) return false;
+
+	// no value takes more than 8 bytes (an escape is 56 bits), plus the parameter in front of every block.
+	// a damaged header can't make the reader allocate more than that
+	uint64_t valueCount = 2 * (uint64_t)header.nodeCount;
+	uint64_t blockCount = (valueCount + TrajectoryBlockSize - 1) / TrajectoryBlockSize;
+	uint64_t maxPayloadBytes = valueCount * 8 + (blockCount * RiceParameterBits + 7) / 8;
+	if (header.nodeCount > (uint32_t)std::numeric_limits<int>::max() / 2 || header.payloadBytes > maxPayloadBytes) return false;
+
+	payload.resize(header.payloadBytes);
+	file.read(reinterpret_cast<char*>(payload.data()), payload.size());
+	if (!file) return false;
+
+	values.resize(2 * (size_t)header.nodeCount);
+	if (!DecodeValues(payload, values)) return false;
+
+	int nodeCount = header.nodeCount;
+	framesSinceKeyframe = header.isKeyframe ? 0 : framesSinceKeyframe + 1;
+	previousPositions.resize(2 * nodeCount, 0);
+	olderPositions.resize(2 * nodeCount, 0);
+	positions.resize(nodeCount);
+
+	for (int i = 0; i < nodeCount; i++) {
+
+		int32_t x = Predict(framesSinceKeyframe, previousPositions[2 * i], olderPositions[2 * i]) + UnZigZag(values[i]);
+		int32_t y = Predict(framesSinceKeyframe, previousPositions[2 * i + 1], olderPositions[2 * i + 1]) + UnZigZag(values[nodeCount + i]);
+
+		olderPositions[2 * i] = previousPositions[2 * i];
+		olderPositions[2 * i + 1] = previousPositions[2 * i + 1];
+		previousPositions[2 * i] = x;
+		previousPositions[2 * i + 1] = y;
+		positions[i] = Vector2{ (float)(x * (double)precision), (float)(y * (double)precision) };
+	}
+
+	frameIndex = header.frameIndex;
+	return true;
+}
@@ -1,11 +1,15 @@
 
 #include "raylib.h"
 #include <vector>
+#include <algorithm>
+#include <thread>
 #include "resource_dir.h"	// utility header for SearchAndSetResourceDir
 #include "CameraController.h"
 #include "RopeNode.h"
 #include "RopePhysicsSolver.h"
+#include "RopeRenderer.h"
 #include "PhysicsConfig.h"
+#include "InputLog.h"
 
 #include "GUI_Renderer.h"
 
@@ -25,16 +29,16 @@ int main()
 
 	Config DefaultConfig;	//set up config, physics, GUI rrendering
 	InteractionConfig DefaultInteractionCFG;
-	Threadpool threadpool(std::thread::hardware_concurrency());
+	// the main thread runs ParralelFor too, so one worker less than there are cores (at least one)
+	Threadpool threadpool(std::max(2u, std::thread::hardware_concurrency()) - 1);
 
 	RopePhysicsSolver DefaultSolver(DefaultConfig, threadpool);
+	// room for ten of the largest ropes the GUI can add (100000 nodes), so adding ropes while the simulation runs never copies
+	// the nodes that are already there. only address space until the nodes exist
+	DefaultSolver.ReserveNodes(1000000);
 	GUI_Renderer GUI(DefaultSolver, DefaultConfig);
 
 
-	DefaultSolver.SetupRope(Vector2{200,100}, true, 9, 40, 10);		//creating 3 example ropes
-	DefaultSolver.SetupRope(Vector2{400,100}, true, 27, 22, 7);
-	DefaultSolver.SetupRope(Vector2{600,100}, true, 50, 8, 5);
-
 
 	// Tell the window to use vsync and work on high DPI displays
 	// SetConfigFlags(FLAG_VSYNC_HINT);
@@ -50,6 +54,17 @@ int main()
 	// Utility function from resource_dir.h to find the resources folder and set it as the current working directory so we can load from it
 	SearchAndSetResourceDir("resources");
 
+	// continue with the scene saved last time (F5), or start with the example scene
+	if (!DefaultSolver.LoadSnapshot("scene.rsnap")) {
+
+		DefaultSolver.SetupRope(Vector2{200,100}, true, 9, 40, 10);		//creating 3 example ropes
+		DefaultSolver.SetupRope(Vector2{400,100}, true, 27, 22, 7);
+		DefaultSolver.SetupRope(Vector2{600,100}, true, 50, 8, 5);
+
+		DefaultSolver.Colliders.AddBox(Vector2{ -2000, 750 }, Vector2{ 3200, 800 });		//ground and something for the ropes to hang over
+		DefaultSolver.Colliders.AddCircle(Vector2{ 480, 420 }, 50);
+	}
+
 	//load the background image
 	Texture2D background = LoadTexture("Background_for_RopeSim.png");
 	
@@ -57,12 +72,40 @@ int main()
 	GuiLoadStyle("style_jungle.rgs");
 	GuiSetFont(LoadFontEx("Jersey10-Regular.ttf", 128, 0, 0));
 
+	// F6 records the session into session.rlog, replay it with RopeSimHeadless --replay session.rlog
+	InputRecorder inputRecorder;
+	// deterministic mode is only turned on for the recording, this is what it was before
+	bool wasDeterministic = false;
+
 
 	// game loop
 	while (!WindowShouldClose())  // run the loop until the user presses ESCAPE or presses the Close button on the window
 	{
 		CameraMove(mainCamera);
 
+		if (IsKeyPressed(KEY_F5)) DefaultSolver.SaveSnapshot("scene.rsnap");
+
+		if (IsKeyPressed(KEY_F6)) {
+
+			if (inputRecorder.IsOpen()) {
+				inputRecorder.Close();
+				DefaultSolver.InputLog = nullptr;
+				DefaultConfig.physics.deterministic = wasDeterministic;
+			}
+			else {
+				// a replay only matches the recording bit for bit in deterministic mode
+				wasDeterministic = DefaultConfig.physics.deterministic;
+				DefaultConfig.physics.deterministic = true;
+
+				if (inputRecorder.Open("session.rlog", DefaultSolver)) {
+					DefaultSolver.InputLog = &inputRecorder;
+				}
+				else {
+					DefaultConfig.physics.deterministic = wasDeterministic;
+				}
+			}
+		}
+
 		// drawing
 		BeginDrawing();
 		// Setup the back buffer for drawing (clear color and depth buffers)
@@ -72,14 +115,18 @@ int main()
 
 		BeginMode2D(mainCamera); // start world space drawing
 
-		double frameTime = 1.0 / DefaultConfig.TargetFPS;
+		// with a fixed time step the solver needs the real frame time, otherwise it simulates one target frame per frame
+		double frameTime = DefaultConfig.physics.useFixedTimestep ? GetFrameTime() : 1.0 / DefaultConfig.TargetFPS;
 
-		DefaultSolver.HandleRopes(mainCamera, 6, 5, frameTime); //render all ropes and calculate physics
+		DefaultSolver.HandleRopes(ReadInteractionInput(mainCamera), 6, 5, frameTime); //calculate physics
+		RopeRenderer::RenderColliders(DefaultSolver.Colliders, DARKBROWN);
+		RopeRenderer::RenderAllRopes(mainCamera, DefaultSolver); //render all ropes
 
 
 		EndMode2D(); // end world space drawing
 
 		GUI.Render_GUI();
+		if (inputRecorder.IsOpen()) DrawText("recording input (F6 to stop)", 10, GetScreenHeight() - 30, 20, RED);
 
 		// end the frame and get ready for the next one  (display frame, poll input, etc...)
 		EndDrawing();